@@ -12,21 +12,58 @@ ppt_registerRecordDeviceDriver pdbbase
 ## drvAsynIPPortConfigure("portName", "hostname:port", priority, noAutoConnect, noProcessEos)
 drvAsynIPPortConfigure("PPT1", "192.168.197.111:2000", 0, 0, 0)
 
+## Frame reader publishing the decoded channels as asyn parameters
+## pptDriverConfigure("portName", "ioPortName", trendDepth)
+## trendDepth: trend samples per analog channel (0: 3600, one hour at 1 s)
+pptDriverConfigure("PPT1DRV", "PPT1", 3600)
+
 ## Optional: Enable asyn tracing for debugging
 # asynSetTraceMask("PPT1", 0, 0x9)    # ASYN_TRACE_ERROR | ASYN_TRACEIO_DEVICE
 # asynSetTraceIOMask("PPT1", 0, 0x2)  # ASYN_TRACEIO_HEX
 epicsEnvSet("STREAM_PROTOCOL_PATH","../../db")
 
+## Interlock causality graph: consequential interlocks of a trip are
+## suppressed, only root causes keep their alarm severity
+pptCausalityLoad("../../db/ppt_causality.txt")
+
+## Command round-trip histograms (RoundTrip:* PVs), kept across restarts
+pptRoundTripFile("PPT1DRV", "roundtrip_PPT1DRV.txt")
+## Journal of every command written, with its source (pptjournal prints it)
+## pptCommandJournal("portName", "filename", capacity), capacity 0: 1M entries
+pptCommandJournal("PPT1DRV", "journal_PPT1DRV.bin", 0)
+## The journal takes the Channel Access client of a put from a TRAPWRITE
+## rule. ppt.acf allows everything; a site with its own access security
+## file adds TRAPWRITE to its WRITE rules and loads that file instead.
+## Without a TRAPWRITE rule all puts are journaled as "local".
+asSetFilename("../../db/ppt.acf")
+
 ## Load record instances (using corrected aSub approach per documentation)
 ## HVMAX macro sets the maximum operational HV voltage (default: 37 kV)
-dbLoadRecords("../../db/ppt.template", "P=SPARC:MOD:PPT,R=MOD001, PORT=PPT1")
-dbLoadRecords("../../db/ppt_control.template", "P=SPARC:MOD:PPT,R=MOD001, PORT=PPT1, HVMAX=37")
+dbLoadRecords("../../db/ppt.template", "P=SPARC:MOD:PPT,R=MOD001, DRV=PPT1DRV")
+## or the single pptFrame record variant with the same PV names, reading the
+## frames of the same pptDriver port:
+# dbLoadRecords("../../db/ppt_frame.template", "P=SPARC:MOD:PPT,R=MOD001, DRV=PPT1DRV")
+## Whole-frame snapshot: PVA group :Snapshot and CA waveform :Snapshot:Flat
+## (FRAME=SPARC:MOD:PPT:MOD001:Frame with ppt_frame.template)
+dbLoadRecords("../../db/ppt_snapshot.template", "P=SPARC:MOD:PPT,R=MOD001, FRAME=SPARC:MOD:PPT:MOD001:Snapshot:Frame")
+## CMD_TMO: seconds a command waits for its status bit (put-callback, :Confirm)
+dbLoadRecords("../../db/ppt_control.template", "P=SPARC:MOD:PPT,R=MOD001, DRV=PPT1DRV, HVMAX=37, CMD_TMO=5")
 dbLoadRecords("../../db/ppt_autoseq.template", "P=SPARC:MOD:PPT,R=MOD001")
+## Trend waveforms <channel>:Trend/:TrendTime (N >= trendDepth, ppt.template only)
+dbLoadTemplate("../../db/ppt_trend.substitutions", "P=SPARC:MOD:PPT,R=MOD001,DRV=PPT1DRV,N=3600")
 
 
 # cd "${TOP}/iocBoot/${IOC}"
 iocInit
 
+## Diagnostics: frame statistics, "pptReport 1" adds per-word change counters
+# pptReport 1
+## Database cost per frame, e.g. "pptBench SPARC:MOD:PPT:MOD001: Snapshot:Frame 200"
+## Driver deadbands besides the info(pptDeadband) tags, "asynReport 1 PPT1DRV" lists them
+# pptDeadband PPT1DRV Klys:BodyWaterInTemp 0.05 0 2
+## Sequence of events after a trip, last 50 edges with first faults marked
+# pptSoeDump PPT1DRV 50
+
 ## Start any sequence programs
 ## RETRY_DELAY: time in seconds between command retries (default: 5.0)
 seq pptAutoSeq, "P=SPARC:MOD:PPT,R=MOD001,RETRY_DELAY=5.0"
@@ -0,0 +1,245 @@
+/*
+ * devPptConfirm.cpp
+ *
+ * Asynchronous bi device support "pptConfirm": completes when a received
+ * frame shows the state a command asked for, so that a put-callback
+ * (ca_put_callback, caput -c, pvput -w) on a command record returns only
+ * once the modulator has acted on it.
+ *
+ *   field(DTYP, "pptConfirm")
+ *   field(INP,  "@DRV bit[|bit...] state [timeout]")
+ *
+ * DRV is the pptDriver port, bit a status bit of bitMap (pptProto.cpp),
+ * e.g. Thy:Status:ContactsOn; several bits must be of the same word.
+ * state 1: one of the bits is set, state 0: all are clear. timeout is in
+ * seconds (default 5).
+ *
+ * When processed (FLNK of the command record, which has queued the
+ * command in the pptDriver command engine) the record stays active until the
+ * driver posts a frame (Stats:Frames) whose status word matches, then
+ * completes with VAL 1. Without a match within the timeout it completes
+ * with VAL 0 and TIMEOUT/MAJOR alarm. The put-callback of the command
+ * record waits for this record like for any other record it processes.
+ */
+
+#define USE_TYPED_DSET
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <alarm.h>
+#include <callback.h>
+#include <dbAccess.h>
+#include <dbScan.h>
+#include <devSup.h>
+#include <epicsMutex.h>
+#include <recGbl.h>
+#include <biRecord.h>
+#include <asynDriver.h>
+#include <asynInt32.h>
+#include <asynDrvUser.h>
+#include <epicsExport.h>
+
+#include "pptProto.h"
+
+static const double kDefaultTimeout = 5.0;
+
+struct ConfirmPvt {
+    biRecord *prec;
+    asynUser *pasynUserWord;        /* reason: the status word parameter */
+    asynUser *pasynUserFrames;      /* reason: Stats:Frames */
+    asynInt32 *pint32;
+    void *int32Pvt;
+    void *wordRegistrar;
+    void *framesRegistrar;
+    epicsUInt32 mask;
+    int state;
+    double timeout;
+
+    epicsMutexId lock;
+    epicsInt32 word;                /* last status word posted */
+    bool pending;                   /* waiting for a frame */
+    bool confirmed;
+    epicsCallback processCb;
+    epicsCallback timeoutCb;
+};
+
+/* Called with pvt->lock held: complete the record once */
+static void finish(ConfirmPvt *pvt, bool confirmed)
+{
+    if (!pvt->pending)
+        return;
+    pvt->pending = false;
+    pvt->confirmed = confirmed;
+    callbackRequestProcessCallback(&pvt->processCb, priorityMedium, pvt->prec);
+}
+
+static bool matches(const ConfirmPvt *pvt)
+{
+    epicsUInt32 bits = (epicsUInt32)pvt->word & pvt->mask;
+    return pvt->state ? bits != 0 : bits == 0;
+}
+
+/* asyn interrupt callbacks, from the driver's reader thread */
+static void wordCallback(void *userPvt, asynUser *pasynUser, epicsInt32 value)
+{
+    ConfirmPvt *pvt = (ConfirmPvt *)userPvt;
+
+    epicsMutexMustLock(pvt->lock);
+    pvt->word = value;
+    epicsMutexUnlock(pvt->lock);
+}
+
+static void framesCallback(void *userPvt, asynUser *pasynUser, epicsInt32 value)
+{
+    ConfirmPvt *pvt = (ConfirmPvt *)userPvt;
+
+    /* The word parameters are posted before Stats:Frames of the same frame */
+    epicsMutexMustLock(pvt->lock);
+    if (pvt->pending && matches(pvt))
+        finish(pvt, true);
+    epicsMutexUnlock(pvt->lock);
+}
+
+static void timeoutCallback(epicsCallback *pcb)
+{
+    void *user;
+    ConfirmPvt *pvt;
+
+    callbackGetUser(user, pcb);
+    pvt = (ConfirmPvt *)user;
+    epicsMutexMustLock(pvt->lock);
+    finish(pvt, false);
+    epicsMutexUnlock(pvt->lock);
+}
+
+/* Parse "bit[|bit...]" into the status word parameter and mask */
+static const char *parseBits(char *bits, epicsUInt32 *mask)
+{
+    int word = -1;
+
+    *mask = 0;
+    for (char *name = strtok(bits, "|"); name; name = strtok(NULL, "|")) {
+        size_t n;
+
+        for (n = 0; n < ppt::numBits; n++)
+            if (strcmp(ppt::bitMap[n].name, name) == 0)
+                break;
+        if (n == ppt::numBits || ppt::bitMap[n].severity != ppt::kStatusBit ||
+            (word >= 0 && ppt::bitMap[n].word != word))
+            return NULL;
+        word = ppt::bitMap[n].word;
+        *mask |= 1u << ppt::bitMap[n].bit;
+    }
+    for (int c = 0; word >= 0 && c < ppt::kNumChannels; c++)
+        if (ppt::channelMap[c].kind == ppt::kBits && ppt::channelMap[c].word == word)
+            return ppt::channelMap[c].name;
+    return NULL;
+}
+
+/* asynUser on port with the reason of drvInfo */
+static asynUser *connectParam(ConfirmPvt *pvt, const char *port, const char *drvInfo)
+{
+    asynUser *pasynUser = pasynManager->createAsynUser(NULL, NULL);
+    asynInterface *pinterface;
+
+    pasynUser->userPvt = pvt;
+    if (pasynManager->connectDevice(pasynUser, port, 0) != asynSuccess ||
+        !(pinterface = pasynManager->findInterface(pasynUser, asynDrvUserType, 1)) ||
+        ((asynDrvUser *)pinterface->pinterface)->create(pinterface->drvPvt, pasynUser,
+                                                         drvInfo, NULL, NULL) != asynSuccess) {
+        pasynManager->freeAsynUser(pasynUser);
+        return NULL;
+    }
+    return pasynUser;
+}
+
+static long init_record(dbCommon *pcommon)
+{
+    biRecord *prec = (biRecord *)pcommon;
+    ConfirmPvt *pvt;
+    asynInterface *pinterface;
+    char port[64], bits[256];
+    const char *wordParam;
+    epicsUInt32 mask;
+    double timeout = kDefaultTimeout;
+    int state;
+
+    if (prec->inp.type != INST_IO ||
+        sscanf(prec->inp.value.instio.string, "%63s %255s %d %lf", port, bits, &state,
+               &timeout) < 3 || timeout <= 0.0) {
+        printf("%s: pptConfirm: INP must be \"@port bit[|bit...] state [timeout]\"\n",
+               prec->name);
+        prec->pact = 1;
+        return S_db_badField;
+    }
+
+    if (!(wordParam = parseBits(bits, &mask))) {
+        printf("%s: pptConfirm: unknown status bit or bits of different words\n", prec->name);
+        prec->pact = 1;
+        return S_db_badField;
+    }
+
+    pvt = (ConfirmPvt *)calloc(1, sizeof(ConfirmPvt));
+    pvt->prec = prec;
+    pvt->mask = mask;
+    pvt->state = state != 0;
+    pvt->timeout = timeout;
+    pvt->lock = epicsMutexMustCreate();
+    callbackSetCallback(timeoutCallback, &pvt->timeoutCb);
+    callbackSetUser(pvt, &pvt->timeoutCb);
+
+    if (!(pvt->pasynUserWord = connectParam(pvt, port, wordParam)) ||
+        !(pvt->pasynUserFrames = connectParam(pvt, port, "Stats:Frames")) ||
+        !(pinterface = pasynManager->findInterface(pvt->pasynUserWord, asynInt32Type, 1))) {
+        printf("%s: pptConfirm: %s is not a pptDriver port\n", prec->name, port);
+        prec->pact = 1;
+        return S_db_badField;
+    }
+    pvt->pint32 = (asynInt32 *)pinterface->pinterface;
+    pvt->int32Pvt = pinterface->drvPvt;
+
+    /* Current word: the driver posts it only when it changes */
+    pasynManager->lockPort(pvt->pasynUserWord);
+    pvt->pint32->read(pvt->int32Pvt, pvt->pasynUserWord, &pvt->word);
+    pvt->pint32->registerInterruptUser(pvt->int32Pvt, pvt->pasynUserWord, wordCallback, pvt,
+                                       &pvt->wordRegistrar);
+    pvt->pint32->registerInterruptUser(pvt->int32Pvt, pvt->pasynUserFrames, framesCallback,
+                                       pvt, &pvt->framesRegistrar);
+    pasynManager->unlockPort(pvt->pasynUserWord);
+
+    prec->dpvt = pvt;
+    return 0;
+}
+
+static long read_bi(biRecord *prec)
+{
+    ConfirmPvt *pvt = (ConfirmPvt *)prec->dpvt;
+
+    if (!pvt)
+        return -1;
+
+    if (!prec->pact) {
+        /* Command written: wait for a frame showing its effect */
+        epicsMutexMustLock(pvt->lock);
+        pvt->pending = true;
+        epicsMutexUnlock(pvt->lock);
+        callbackRequestDelayed(&pvt->timeoutCb, pvt->timeout);
+        prec->pact = 1;
+        return 0;
+    }
+
+    callbackCancelDelayed(&pvt->timeoutCb);
+    prec->val = pvt->confirmed;
+    prec->udf = 0;
+    if (!pvt->confirmed)
+        recGblSetSevr(prec, TIMEOUT_ALARM, MAJOR_ALARM);
+    return 2;
+}
+
+static bidset devPptConfirm = {
+    { 5, NULL, NULL, init_record, NULL },
+    read_bi
+};
+epicsExportAddress(dset, devPptConfirm);
@@ -0,0 +1,41 @@
+/*
+ * devPptFrameSoft.cpp
+ *
+ * Soft Channel device support for the pptFrame record: reads the raw
+ * frame from the INP link, normally the RawData waveform filled by
+ * StreamDevice (readAllData in ppt.proto).
+ */
+
+#define USE_TYPED_DSET
+
+#include <alarm.h>
+#include <dbAccess.h>
+#include <dbLink.h>
+#include <devSup.h>
+#include <recGbl.h>
+#include <epicsExport.h>
+
+#include "pptFrameRecord.h"
+
+static long read_frame(pptFrameRecord *prec) {
+    long nRequest = sizeof(prec->raw);
+    long status;
+
+    status = dbGetLink(&prec->inp, DBR_UCHAR, prec->raw, 0, &nRequest);
+    if (status) {
+        prec->nraw = 0;
+        recGblSetSevr(prec, LINK_ALARM, INVALID_ALARM);
+        return status;
+    }
+    prec->nraw = (epicsUInt32)nRequest;
+    return 0;
+}
+
+static struct {
+    dset common;
+    long (*read_frame)(pptFrameRecord *prec);
+} devPptFrameSoft = {
+    { 5, NULL, NULL, NULL, NULL },
+    read_frame
+};
+epicsExportAddress(dset, devPptFrameSoft);
@@ -0,0 +1,279 @@
+/*
+ * pptBench.cpp
+ *
+ * iocsh command comparing database layouts of one modulator instance:
+ *
+ *   pptBench prefix stage [frames] [quiet]
+ *
+ *   prefix  record name prefix of the instance, e.g. "SPARC:MOD:PPT:MOD001:"
+ *   stage   first record after RawData: "Snapshot:Frame" (ppt.template)
+ *           or "Frame" (ppt_frame.template)
+ *   frames  synthetic frames to push through (default 200)
+ *   quiet   1 = only analog words change, 0 = every word changes (default)
+ *
+ * Footprint: records, lock sets and memory (record structures plus array
+ * buffers allocated outside them) of all records with the prefix.
+ *
+ * Cost: each synthetic frame is written to prefix:RawData and the stage
+ * record is processed under its lock. "sync" is the time spent in that
+ * call (forward links included); "cpu" is the process CPU time per frame
+ * after the CP links have drained, minus the idle CPU of the IOC.
+ *
+ * Run it on an IOC without clients, with the instances loaded under
+ * different R macros, e.g. MOD001 with ppt.template and MOD002 with
+ * ppt_frame.template.
+ *
+ * Startup cost of a fleet, between marks placed in st.cmd (pptfleet
+ * writes them around dbLoadRecords and iocInit):
+ *
+ *   pptStartupMark label
+ *
+ * prints the time since the previous mark, the records loaded and the
+ * resident memory of the IOC (Linux, VmRSS).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <set>
+#include <string>
+
+#include <epicsTime.h>
+#include <epicsThread.h>
+#include <epicsTypes.h>
+#include <dbAccess.h>
+#include <dbStaticLib.h>
+#include <dbLock.h>
+#include <special.h>
+#include <iocsh.h>
+#include <epicsExport.h>
+
+#include "pptFrameView.h"
+#include "pptProto.h"
+
+namespace {
+
+const double kFramePeriod = 0.005;      /* pacing between frames, seconds */
+
+/* Synthetic frame number i: values inside the register map */
+void makeFrame(int i, bool quiet, ppt::FrameBuffer &frame)
+{
+    for (int w = 0; w < ppt::kFrameWords; w++) {
+        const ppt::WordInfo &desc = ppt::wordMap[w];
+        bool analog = !ppt::wordLsbFirst(w);
+        uint16_t raw;
+
+        if (analog)
+            raw = (uint16_t)((i * 7 + w * 13) % (desc.maxValue + 1));
+        else if (quiet)
+            raw = 0;
+        else
+            raw = (uint16_t)((i * 0x9E37u + w * 0x79B9u) & desc.bitMask);
+        uint8_t *p = frame.bytes + 2 * w;
+        if (ppt::wordLsbFirst(w)) {
+            p[0] = (uint8_t)(raw & 0xFF);
+            p[1] = (uint8_t)(raw >> 8);
+        } else {
+            p[0] = (uint8_t)(raw >> 8);
+            p[1] = (uint8_t)(raw & 0xFF);
+        }
+    }
+}
+
+void footprint(const char *prefix)
+{
+    DBENTRY entry;
+    std::set<unsigned long> lockSets;
+    size_t prefixLen = strlen(prefix);
+    unsigned long records = 0, bytes = 0;
+    long status;
+
+    dbInitEntry(pdbbase, &entry);
+    for (status = dbFirstRecordType(&entry); !status; status = dbNextRecordType(&entry)) {
+        long rstatus;
+        for (rstatus = dbFirstRecord(&entry); !rstatus; rstatus = dbNextRecord(&entry)) {
+            const char *name = dbGetRecordName(&entry);
+            dbCommon *precord;
+            size_t recSize;
+            long fstatus;
+
+            if (dbIsAlias(&entry) || strncmp(name, prefix, prefixLen) != 0)
+                continue;
+
+            precord = (dbCommon *)entry.precnode->precord;
+            recSize = entry.precordType->rec_size;
+            records++;
+            bytes += recSize;
+            lockSets.insert(dbLockGetLockId(precord));
+
+            /* Arrays whose buffer lives outside the record structure */
+            for (fstatus = dbFirstField(&entry, 0); !fstatus; fstatus = dbNextField(&entry, 0)) {
+                std::string pv;
+                DBADDR addr;
+                const char *pfield;
+
+                if (entry.pflddes->special != SPC_DBADDR)
+                    continue;
+                pv = std::string(name) + "." + entry.pflddes->name;
+                if (dbNameToAddr(pv.c_str(), &addr) || addr.no_elements <= 1)
+                    continue;
+                pfield = (const char *)addr.pfield;
+                if (pfield >= (const char *)precord && pfield < (const char *)precord + recSize)
+                    continue;
+                bytes += addr.no_elements * addr.field_size;
+            }
+        }
+    }
+    dbFinishEntry(&entry);
+
+    printf("pptBench: %s* %lu records, %lu lock sets, %lu bytes\n",
+           prefix, records, (unsigned long)lockSets.size(), bytes);
+}
+
+/* Resident set size in kB, 0 if unknown */
+unsigned long residentKb()
+{
+    char line[128];
+    unsigned long kb = 0;
+    FILE *fp = fopen("/proc/self/status", "r");
+
+    if (!fp)
+        return 0;
+    while (fgets(line, sizeof(line), fp))
+        if (sscanf(line, "VmRSS: %lu", &kb) == 1)
+            break;
+    fclose(fp);
+    return kb;
+}
+
+void pptStartupMark(const char *label)
+{
+    static epicsTimeStamp first, last;
+    static bool started = false;
+    epicsTimeStamp now;
+    DBENTRY entry;
+    unsigned long records = 0, rss = residentKb();
+    long status;
+
+    epicsTimeGetCurrent(&now);
+    if (!started) {
+        first = last = now;
+        started = true;
+    }
+    if (pdbbase) {
+        dbInitEntry(pdbbase, &entry);
+        for (status = dbFirstRecordType(&entry); !status; status = dbNextRecordType(&entry))
+            records += dbGetNRecords(&entry);
+        dbFinishEntry(&entry);
+    }
+
+    printf("pptStartupMark: %-16s +%8.3f s  total %8.3f s  %6lu records  RSS ",
+           label ? label : "", epicsTimeDiffInSeconds(&now, &last),
+           epicsTimeDiffInSeconds(&now, &first), records);
+    if (rss)
+        printf("%lu kB\n", rss);
+    else
+        printf("n/a\n");
+    last = now;
+}
+
+double cpuSeconds()
+{
+    return (double)clock() / CLOCKS_PER_SEC;
+}
+
+void pptBench(const char *prefix, const char *stage, int frames, int quiet)
+{
+    std::string rawName, stageName;
+    DBADDR rawAddr, stageAddr;
+    dbCommon *pstage, *praw;
+    ppt::FrameBuffer frame;
+    epicsTimeStamp t0, t1, start, end;
+    double idle, cpu0, cpu1, elapsed, sync = 0.0, syncMax = 0.0;
+
+    if (!prefix || !stage) {
+        printf("Usage: pptBench prefix stage [frames] [quiet]\n");
+        return;
+    }
+    if (frames <= 0)
+        frames = 200;
+
+    rawName = std::string(prefix) + "RawData";
+    stageName = std::string(prefix) + stage;
+    if (dbNameToAddr(rawName.c_str(), &rawAddr) || dbNameToAddr(stageName.c_str(), &stageAddr)) {
+        printf("pptBench: %s or %s not found\n", rawName.c_str(), stageName.c_str());
+        return;
+    }
+    praw = (dbCommon *)rawAddr.precord;
+    pstage = (dbCommon *)stageAddr.precord;
+
+    footprint(prefix);
+
+    /* Idle CPU of the IOC, subtracted below */
+    cpu0 = cpuSeconds();
+    epicsThreadSleep(1.0);
+    idle = cpuSeconds() - cpu0;
+
+    epicsTimeGetCurrent(&start);
+    cpu0 = cpuSeconds();
+    for (int i = 0; i < frames; i++) {
+        makeFrame(i, quiet != 0, frame);
+
+        dbScanLock(praw);
+        dbPut(&rawAddr, DBR_UCHAR, frame.bytes, ppt::kFrameBytes);
+        dbScanUnlock(praw);
+
+        dbScanLock(pstage);
+        epicsTimeGetCurrent(&t0);
+        dbProcess(pstage);
+        epicsTimeGetCurrent(&t1);
+        dbScanUnlock(pstage);
+
+        double dt = epicsTimeDiffInSeconds(&t1, &t0);
+        sync += dt;
+        if (dt > syncMax)
+            syncMax = dt;
+        epicsThreadSleep(kFramePeriod);
+    }
+    epicsThreadSleep(0.5);          /* let CP links and monitors drain */
+    cpu1 = cpuSeconds();
+    epicsTimeGetCurrent(&end);
+    elapsed = epicsTimeDiffInSeconds(&end, &start);
+
+    printf("pptBench: %d %s frames through %s: sync %.1f us/frame (max %.1f), "
+           "cpu %.1f us/frame\n",
+           frames, quiet ? "quiet" : "busy", stage, sync / frames * 1e6, syncMax * 1e6,
+           ((cpu1 - cpu0) - idle * elapsed) / frames * 1e6);
+}
+
+const iocshArg pptBenchArg0 = { "prefix", iocshArgString };
+const iocshArg pptBenchArg1 = { "stage", iocshArgString };
+const iocshArg pptBenchArg2 = { "frames", iocshArgInt };
+const iocshArg pptBenchArg3 = { "quiet", iocshArgInt };
+const iocshArg * const pptBenchArgs[] = {
+    &pptBenchArg0, &pptBenchArg1, &pptBenchArg2, &pptBenchArg3
+};
+const iocshFuncDef pptBenchFuncDef = { "pptBench", 4, pptBenchArgs };
+
+void pptBenchCallFunc(const iocshArgBuf *args)
+{
+    pptBench(args[0].sval, args[1].sval, args[2].ival, args[3].ival);
+}
+
+const iocshArg pptStartupMarkArg0 = { "label", iocshArgString };
+const iocshArg * const pptStartupMarkArgs[] = { &pptStartupMarkArg0 };
+const iocshFuncDef pptStartupMarkFuncDef = { "pptStartupMark", 1, pptStartupMarkArgs };
+
+void pptStartupMarkCallFunc(const iocshArgBuf *args)
+{
+    pptStartupMark(args[0].sval);
+}
+
+} // namespace
+
+static void pptBenchRegister(void)
+{
+    iocshRegister(&pptBenchFuncDef, pptBenchCallFunc);
+    iocshRegister(&pptStartupMarkFuncDef, pptStartupMarkCallFunc);
+}
+epicsExportRegistrar(pptBenchRegister);
@@ -0,0 +1,159 @@
+/*
+ * pptCausality.cpp
+ *
+ * Interlock causality graph, see pptCausality.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pptCausality.h"
+#include "pptInterlocks.h"
+
+namespace ppt {
+
+CausalityGraph::CausalityGraph()
+{
+    clear();
+}
+
+void CausalityGraph::clear()
+{
+    edges_ = 0;
+    memset(direct_, 0, sizeof(direct_));
+    memset(reach_, 0, sizeof(reach_));
+}
+
+/* Interlock bits whose bitMap name matches pattern (trailing '*' = prefix) */
+bool CausalityGraph::match(const char *pattern, uint16_t nodes[kNumInterlockWords]) const
+{
+    size_t len = strlen(pattern);
+    bool prefix = len > 0 && pattern[len - 1] == '*';
+    bool found = false;
+
+    if (prefix)
+        len--;
+    for (int i = 0; i < kNumInterlockWords; i++) {
+        nodes[i] = 0;
+        for (int b = 0; b < 16; b++) {
+            const char *name = interlockName(i, b);
+            if (!name || strncmp(name, pattern, len) != 0 || (!prefix && name[len] != '\0'))
+                continue;
+            nodes[i] |= (uint16_t)(1u << b);
+            found = true;
+        }
+    }
+    return found;
+}
+
+int CausalityGraph::parseLine(const char *line)
+{
+    char cause[64], name[64];
+    uint16_t causes[kNumInterlockWords], consequences[kNumInterlockWords];
+    int n, added = 0;
+
+    if (sscanf(line, " %63s%n", cause, &n) != 1 || cause[0] == '#')
+        return 0;
+    if (!match(cause, causes))
+        return -1;
+    line += n;
+    while (sscanf(line, " %63s%n", name, &n) == 1 && name[0] != '#') {
+        line += n;
+        if (!match(name, consequences))
+            return -1;
+        for (int i = 0; i < kNumInterlockWords; i++) {
+            for (int b = 0; b < 16; b++) {
+                if (!(causes[i] & (1u << b)))
+                    continue;
+                for (int j = 0; j < kNumInterlockWords; j++) {
+                    uint16_t add = consequences[j] & (uint16_t)~direct_[i * 16 + b][j];
+                    if (j == i)
+                        add &= (uint16_t)~(1u << b);
+                    direct_[i * 16 + b][j] |= add;
+                    for (; add; add &= add - 1)
+                        added++;
+                }
+            }
+        }
+    }
+    edges_ += added;
+    close();
+    return added;
+}
+
+int CausalityGraph::load(const char *filename)
+{
+    char line[512];
+    int lineNo = 0;
+    FILE *fp = fopen(filename, "r");
+
+    if (!fp)
+        return -1;
+    clear();
+    while (fgets(line, sizeof(line), fp)) {
+        lineNo++;
+        if (parseLine(line) < 0) {
+            fprintf(stderr, "%s:%d: unknown interlock name\n", filename, lineNo);
+            fclose(fp);
+            clear();
+            return -1;
+        }
+    }
+    fclose(fp);
+    return (int)edges_;
+}
+
+/* Transitive closure of direct_ (Warshall over the 144 bit nodes) */
+void CausalityGraph::close()
+{
+    memcpy(reach_, direct_, sizeof(reach_));
+    for (int k = 0; k < kNodes; k++) {
+        int kw = k / 16;
+        uint16_t kbit = (uint16_t)(1u << (k % 16));
+        for (int a = 0; a < kNodes; a++) {
+            if (!(reach_[a][kw] & kbit))
+                continue;
+            for (int j = 0; j < kNumInterlockWords; j++)
+                reach_[a][j] |= reach_[k][j];
+        }
+    }
+}
+
+void CausalityGraph::evaluate(const uint16_t active[kNumInterlockWords],
+                              uint16_t root[kNumInterlockWords],
+                              uint16_t suppressed[kNumInterlockWords]) const
+{
+    int nodes[kNodes];
+    int numActive = 0;
+
+    for (int i = 0; i < kNumInterlockWords; i++) {
+        root[i] = active[i];
+        suppressed[i] = 0;
+        for (uint16_t bits = active[i]; bits; bits &= bits - 1) {
+            int b = 0;
+            while (!(bits & (1u << b)))
+                b++;
+            nodes[numActive++] = i * 16 + b;
+        }
+    }
+    if (!edges_)
+        return;
+
+    /* b is suppressed by an active a that reaches b but is not reached back */
+    for (int x = 0; x < numActive; x++) {
+        int b = nodes[x], bw = b / 16;
+        uint16_t bbit = (uint16_t)(1u << (b % 16));
+
+        for (int y = 0; y < numActive; y++) {
+            int a = nodes[y];
+            if (a == b || !(reach_[a][bw] & bbit) ||
+                (reach_[b][a / 16] & (1u << (a % 16))))
+                continue;
+            suppressed[bw] |= bbit;
+            root[bw] &= (uint16_t)~bbit;
+            break;
+        }
+    }
+}
+
+} // namespace ppt
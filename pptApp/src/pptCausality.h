@@ -0,0 +1,68 @@
+/*
+ * pptCausality.h
+ *
+ * Interlock causality graph for alarm-flood suppression
+ *
+ * An edge "cause -> consequence" between two interlock bits of bitMap says
+ * that the consequence trips whenever the cause does, e.g. Emergency Off
+ * drops the HVPS, magnet and klystron supplies. For the active bits of a
+ * frame, a bit is suppressed when an active bit reaches it through the
+ * graph and is not reached back from it; the remaining active bits are
+ * the root causes. Bits on a cycle that are all active stay root causes.
+ *
+ * The graph is read from a text file, one cause per line followed by its
+ * consequences; a name ending in '*' matches every bit with that prefix:
+ *
+ *   # cause                         consequences
+ *   General:Interlock:EmergencyOff  HVPS:Interlock:* Klys:Interlock:*
+ */
+
+#ifndef PPTCAUSALITY_H
+#define PPTCAUSALITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pptFrameView.h"
+
+namespace ppt {
+
+class CausalityGraph {
+public:
+    CausalityGraph();
+
+    /* Remove all edges */
+    void clear();
+
+    /*
+     * Add the edges of one line "cause consequence...". Returns the number
+     * of edges added, -1 if a name matches no interlock bit.
+     */
+    int parseLine(const char *line);
+
+    /* Replace the graph by the one in file; returns the edges or -1 */
+    int load(const char *filename);
+
+    size_t edges() const { return edges_; }
+
+    /*
+     * Split the active bits per interlock word (interlockWords order) into
+     * root causes and suppressed consequences.
+     */
+    void evaluate(const uint16_t active[kNumInterlockWords], uint16_t root[kNumInterlockWords],
+                  uint16_t suppressed[kNumInterlockWords]) const;
+
+private:
+    static const int kNodes = kNumInterlockWords * 16;
+
+    bool match(const char *pattern, uint16_t nodes[kNumInterlockWords]) const;
+    void close();
+
+    size_t edges_;
+    uint16_t direct_[kNodes][kNumInterlockWords];   /* consequences of a node */
+    uint16_t reach_[kNodes][kNumInterlockWords];    /* transitive closure */
+};
+
+} // namespace ppt
+
+#endif /* PPTCAUSALITY_H */
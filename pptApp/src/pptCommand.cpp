@@ -0,0 +1,216 @@
+/*
+ * pptCommand.cpp
+ *
+ * Command queue of the command engine, see pptCommand.h
+ */
+
+#include <string.h>
+
+#include "pptCommand.h"
+
+namespace ppt {
+
+CommandQueue::CommandQueue(size_t capacity)
+    : capacity_(capacity ? capacity : 1)
+{
+}
+
+CommandPriority commandPriority(int command)
+{
+    if (command >= 0 && command < kNumCommands &&
+        (command == ResetOn || commandMap[command].bit >= 8))
+        return kPrioritySafety;
+    return kPriorityNormal;
+}
+
+uint32_t supersededBy(int command)
+{
+    if (command < ThyOff || command > ChargePFNOff)
+        return 0;
+    /* The OFF bits are the ON bits + 8, in the same order */
+    if (command == HVPSOff)
+        return (1u << HVPSOn) | (1u << ChargePFNOn);
+    return 1u << (command - ThyOff);
+}
+
+bool CommandQueue::push(int command, double time, int source,
+                        std::vector<QueuedCommand> &cancelled)
+{
+    QueuedCommand entry;
+    std::deque<QueuedCommand>::iterator it;
+
+    entry.command = command;
+    entry.queued = time;
+    entry.source = source;
+    if (commandPriority(command) != kPrioritySafety) {
+        if (queue_.size() >= capacity_)
+            return false;
+        queue_.push_back(entry);
+        return true;
+    }
+
+    uint32_t mask = supersededBy(command);
+    for (it = queue_.begin(); it != queue_.end();) {
+        if (it->command < kNumCommands && (mask & (1u << it->command))) {
+            cancelled.push_back(*it);
+            it = queue_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (queue_.size() >= capacity_) {
+        if (commandPriority(queue_.back().command) == kPrioritySafety)
+            return false;
+        cancelled.push_back(queue_.back());
+        queue_.pop_back();
+    }
+    /* Safety entries are always at the front */
+    for (it = queue_.begin(); it != queue_.end(); ++it)
+        if (commandPriority(it->command) != kPrioritySafety)
+            break;
+    queue_.insert(it, entry);
+    return true;
+}
+
+bool CommandQueue::pop(QueuedCommand &entry)
+{
+    if (queue_.empty())
+        return false;
+    entry = queue_.front();
+    queue_.pop_front();
+    return true;
+}
+
+namespace {
+
+/* commandMap order; NULL: no status transition */
+const struct {
+    const char *bits[2];
+    int state;
+} effects[kNumCommands] = {
+    { { "Thy:Status:ContactsOn", NULL }, 1 },
+    { { "Klys:Status:OnOff", NULL }, 1 },
+    { { "Klys:Status:Timer100Running", "Klys:Status:HeaterVoltage100Percent" }, 1 },
+    { { "Focus:Status:OnOff", NULL }, 1 },
+    { { "Premag:Status:OnOff", NULL }, 1 },
+    { { "HVPS:Status:OnOff", NULL }, 1 },
+    { { "HVPS:Status:HighVoltageOnOff", NULL }, 1 },
+    { { NULL, NULL }, 0 },
+    { { "Thy:Status:ContactsOn", NULL }, 0 },
+    { { "Klys:Status:OnOff", NULL }, 0 },
+    { { "Klys:Status:Timer100Running", "Klys:Status:HeaterVoltage100Percent" }, 0 },
+    { { "Focus:Status:OnOff", NULL }, 0 },
+    { { "Premag:Status:OnOff", NULL }, 0 },
+    { { "HVPS:Status:OnOff", NULL }, 0 },
+    { { "HVPS:Status:HighVoltageOnOff", NULL }, 0 },
+    { { NULL, NULL }, 0 },
+};
+
+} // namespace
+
+bool commandEffect(int command, CommandEffect &effect)
+{
+    effect.word = -1;
+    effect.mask = 0;
+    effect.state = 0;
+    if (command < 0 || command >= kNumCommands)
+        return false;
+    for (int b = 0; b < 2 && effects[command].bits[b]; b++) {
+        for (size_t n = 0; n < numBits; n++) {
+            if (strcmp(bitMap[n].name, effects[command].bits[b]) != 0)
+                continue;
+            effect.word = bitMap[n].word;
+            effect.mask |= (uint16_t)(1u << bitMap[n].bit);
+        }
+    }
+    effect.state = effects[command].state;
+    return effect.mask != 0;
+}
+
+bool CommandQueue::popCompatible(uint16_t bits, QueuedCommand &entry)
+{
+    if (queue_.empty() || !commandCompatible(queue_.front().command, bits))
+        return false;
+    return pop(entry);
+}
+
+int CommandQueue::headCommand() const
+{
+    return queue_.empty() ? -1 : queue_.front().command;
+}
+
+uint16_t commandBits(int command)
+{
+    if (command >= 0 && command < kNumCommands)
+        return (uint16_t)(1u << commandMap[command].bit);
+    return 0;
+}
+
+namespace {
+
+/*
+ * ON and OFF bits of the subsystem of a command bit; the two klystron
+ * levels are one subsystem, so are the HVPS and the Charge PFN
+ */
+uint16_t subsystemBits(uint16_t bit)
+{
+    const uint16_t klys = (uint16_t)(commandBits(KlysOn80) | commandBits(KlysOn100));
+    const uint16_t hvps = (uint16_t)(commandBits(HVPSOn) | commandBits(ChargePFNOn));
+    uint16_t on = (uint16_t)((bit | (bit >> 8)) & 0xff);
+
+    if (on & klys)
+        on = klys;
+    else if (on & hvps)
+        on = hvps;
+    return (uint16_t)(on | (on << 8));
+}
+
+} // namespace
+
+bool commandCompatible(int command, uint16_t bits)
+{
+    const uint16_t reset = (uint16_t)(commandBits(ResetOn) | commandBits(ResetOff));
+    uint16_t bit = commandBits(command);
+    uint16_t opposite;
+
+    if (!bit)
+        return true;
+    if ((bit | bits) & reset)
+        return false;
+    /* ON bits 0-7, OFF bits 8-15 of the same subsystem */
+    opposite = (uint16_t)(subsystemBits(bit) & (bit & 0xff ? 0xff00 : 0x00ff));
+    return !(bits & (bit | opposite));
+}
+
+uint16_t supersedeBatch(int command, std::vector<QueuedCommand> &batch,
+                        std::vector<QueuedCommand> &cancelled)
+{
+    uint32_t mask = supersededBy(command);
+    uint16_t bits = 0;
+    std::vector<QueuedCommand>::iterator it;
+
+    for (it = batch.begin(); it != batch.end();) {
+        if (it->command < kNumCommands && (mask & (1u << it->command))) {
+            cancelled.push_back(*it);
+            it = batch.erase(it);
+        } else {
+            bits |= commandBits(it->command);
+            ++it;
+        }
+    }
+    return bits;
+}
+
+uint32_t commandEntryImage(int command, uint16_t hvRaw)
+{
+    return commandImage(commandBits(command), hvRaw);
+}
+
+const char *commandKindName(int command)
+{
+    if (command >= 0 && command < kNumCommands)
+        return commandMap[command].name;
+    return command == kSetHV ? "HVPS:VoltageSet" : "?";
+}
+
+} // namespace ppt
@@ -0,0 +1,122 @@
+/*
+ * pptCommand.h
+ *
+ * Command queue of the command engine (pptDriver)
+ *
+ * Entries are ON/OFF commands of commandMap or kSetHV, a write of the HV
+ * setpoint alone. The queue does not hold the 32-bit image: it is composed
+ * when an entry is sent, from the command bit and the HV setpoint of that
+ * moment, so a setpoint change is never lost between two commands.
+ *
+ * Two priority classes: the safety commands (every OFF bit and Reset) are
+ * queued ahead of all ON commands and setpoint changes, in order among
+ * themselves. An OFF cancels the queued ON commands it supersedes, the ON
+ * of the same supply (HVPS OFF also Charge PFN ON), and makes room in a
+ * full queue by cancelling the newest ON command or setpoint change.
+ *
+ * Coalescing: the command word is a bitfield, so the entries at the head
+ * of the queue can share one image. An entry joins the image unless its
+ * bit or an opposite bit of the same subsystem (ON vs OFF; both klystron
+ * levels, HVPS with Charge PFN) is already in it; Reset is never
+ * combined. A safety entry first drops the entries of the image it
+ * supersedes (supersedeBatch). Setpoint entries always join, the image
+ * carries the setpoint anyway. Taking stops at the first entry that does
+ * not join, so the order of the commands is kept.
+ */
+
+#ifndef PPTCOMMAND_H
+#define PPTCOMMAND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include "pptProto.h"
+
+namespace ppt {
+
+const int kSetHV = kNumCommands;            /* entry writing the setpoint only */
+const int kNumCommandKinds = kNumCommands + 1;
+
+enum CommandPriority { kPrioritySafety, kPriorityNormal, kNumPriorities };
+
+CommandPriority commandPriority(int command);
+
+/* Mask (bit = Command) of the ON commands an OFF command supersedes */
+uint32_t supersededBy(int command);
+
+struct QueuedCommand {
+    int command;            /* Command or kSetHV */
+    double queued;          /* time of the request, seconds */
+    int source;             /* who requested it, pptJournal.h */
+};
+
+class CommandQueue {
+public:
+    explicit CommandQueue(size_t capacity = 64);
+
+    /*
+     * Queue by priority; the entries cancelled by it are appended to
+     * cancelled. False if the queue is full.
+     */
+    bool push(int command, double time, int source, std::vector<QueuedCommand> &cancelled);
+    bool pop(QueuedCommand &entry);
+
+    /* Pop the head if it may join an image with bits; see above */
+    bool popCompatible(uint16_t bits, QueuedCommand &entry);
+
+    /* Command of the head entry, -1 if empty */
+    int headCommand() const;
+
+    size_t size() const { return queue_.size(); }
+    bool empty() const { return queue_.empty(); }
+
+private:
+    std::deque<QueuedCommand> queue_;
+    size_t capacity_;
+};
+
+/*
+ * Status transition a command causes, the same as its :Confirm record in
+ * ppt_control.template: frame word, bits of bitMap and the state they
+ * reach (1: one of them set, 0: all clear). False for Reset and kSetHV,
+ * which have none.
+ */
+struct CommandEffect {
+    int word;
+    uint16_t mask;
+    int state;
+};
+
+bool commandEffect(int command, CommandEffect &effect);
+
+/* Command word bit of an entry, 0 for kSetHV */
+uint16_t commandBits(int command);
+
+/*
+ * Command word bits that act on their rising edge (register map, Reset
+ * command): the ON bits 0-6 and Reset, bits 7 and 15. The OFF bits 8-14
+ * are levels, "OFF while Bit8=1", and are never pulsed.
+ */
+const uint16_t kEdgeBits = 0x80ff;
+
+/* Whether command may be written in the same image as bits */
+bool commandCompatible(int command, uint16_t bits);
+
+/*
+ * Move the entries of batch that command supersedes to cancelled; the
+ * command bits of the entries left
+ */
+uint16_t supersedeBatch(int command, std::vector<QueuedCommand> &batch,
+                        std::vector<QueuedCommand> &cancelled);
+
+/* Image of an entry: its command bit (none for kSetHV) and the setpoint */
+uint32_t commandEntryImage(int command, uint16_t hvRaw);
+
+/* Name of a command kind for parameters and reports */
+const char *commandKindName(int command);
+
+} // namespace ppt
+
+#endif /* PPTCOMMAND_H */
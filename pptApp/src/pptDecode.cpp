@@ -0,0 +1,262 @@
+/*
+ * pptDecode.cpp
+ * 
+ * aSub record subroutines and iocsh commands on the decoded PPT Modulator
+ * frame (86 bytes = 43 words)
+ * 
+ * The frame is validated and decoded once, by the pptFrame record
+ * (pptFrameRecord.cpp): Snapshot:Frame of ppt.template, Frame of
+ * ppt_frame.template. It checks every word against the value ranges and
+ * bit masks of the register map (ppt::wordMap), publishes the per-word
+ * quality flags in QUAL, and sets REJ for frames with more than MAXF
+ * failed checks. Channels that failed validation are published invalid:
+ * - Analog channels (ai): NaN, so the soft ai record raises UDF/INVALID
+ * - Integer channels (longin): raw value + ppt::kInvalidFlag, which trips
+ *   the HIHI/HHSV=INVALID limit of the record without touching bits 0-15
+ * 
+ * The record chain here follows it:
+ * - pptInterlockSummary (Interlocks aSub) reads RAW and QUAL of the
+ *   pptFrame record, is disabled by its REJ, and summarises the nine
+ *   interlock words with root causes from the causality graph
+ *   (pptCausalityLoad)
+ * - pptReport prints the frame and word statistics of every pptFrame record
+ * 
+ * Frame layout, register map and scaling come from libpptproto
+ * (pptProto.h, pptFrameView.h), which is shared with the command-line
+ * tools. See COMPLETE_86BYTE_MAPPING.md for full byte-by-byte documentation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <epicsStdio.h>
+#include <epicsTypes.h>
+#include <epicsTime.h>
+#include <epicsMutex.h>
+#include <dbLock.h>
+#include <dbAccess.h>
+#include <dbStaticLib.h>
+#include <iocsh.h>
+#include <epicsExport.h>
+#include <aSubRecord.h>
+#include <registryFunction.h>
+
+#include "pptFrameRecord.h"
+
+#include "pptFrameView.h"
+#include "pptInterlocks.h"
+#include "pptCausality.h"
+#include "pptProto.h"
+
+/*
+ * Causality graph of all Interlocks records, loaded by pptCausalityLoad.
+ * A reload replaces it under pptCausalityLock, so a record never
+ * evaluates a half-built graph.
+ */
+static ppt::CausalityGraph pptCausality;
+static epicsMutexId pptCausalityLock;
+
+/* Names of the bits set in masks (interlockWords order), at most max */
+static epicsUInt32 pptInterlockNames(const epicsUInt16 *masks, epicsOldString *out, epicsUInt32 max) {
+    epicsUInt32 n = 0;
+    int i, b;
+
+    for (i = 0; i < ppt::kNumInterlockWords; i++) {
+        for (b = 0; b < 16 && n < max; b++) {
+            const char *name = ppt::interlockName(i, b);
+            if (!(masks[i] & (1u << b)) || !name)
+                continue;
+            strncpy(out[n], name, sizeof(epicsOldString) - 1);
+            out[n][sizeof(epicsOldString) - 1] = '\0';
+            n++;
+        }
+    }
+    return n;
+}
+
+/*
+ * pptInterlockSummary
+ * 
+ * Summarises all nine interlock words in one pass (ppt::summarizeInterlocks)
+ * and splits the active bits into root causes and suppressed consequences
+ * with the causality graph (pptCausalityLoad; without one every active bit
+ * is a root cause). The interlock bit records read their bit of VALK-VALS
+ * (mbbi, MASK): a suppressed bit is state SUPPRESSED, without alarm, until
+ * it is a root cause again.
+ * 
+ * INPA: Raw data buffer (UCHAR array, 86 bytes), RAW of the pptFrame record
+ * INPB: Quality flags per word (UCHAR array, 43 words), QUAL of the same
+ *       pptFrame record; its rejected frames skip the record (SDIS on REJ)
+ * 
+ * VALA: Active interlock bits per interlock word (USHORT[9], frame order)
+ * VALB: Number of active interlocks (LONG)
+ * VALC: Highest severity (LONG): 0 OK, 1 minor, 2 major, 3 word invalid
+ * VALD: Tripped subsystems (ULONG), bit i = interlock word i
+ *       (Thy, Klys, Focus, Premag, Waveguide, VSWR, Clipper, HVPS, General)
+ * VALE: Names of the active interlocks (STRING[16], NEVE = number shown)
+ * VALF: Root-cause bits per interlock word (USHORT[9])
+ * VALG: Suppressed bits per interlock word (USHORT[9])
+ * VALH: Names of the root causes (STRING[16], NEVH = number shown)
+ * VALI: Names of the suppressed interlocks (STRING[16], NEVI = number shown)
+ * VALJ: Number of suppressed interlocks (LONG)
+ * VALK-VALS: Bit states of each interlock word (ULONG), active bits and the
+ *       suppressed ones << 16, VALK = Thy .. VALS = General
+ */
+static long pptInterlockSummary(aSubRecord *prec) {
+    ppt::FrameView frame((const epicsUInt8 *)prec->a);
+    epicsUInt16 *outActive = (epicsUInt16 *)prec->vala;
+    epicsInt32 *outCount = (epicsInt32 *)prec->valb;
+    epicsInt32 *outSeverity = (epicsInt32 *)prec->valc;
+    epicsUInt32 *outSubsystems = (epicsUInt32 *)prec->vald;
+    epicsOldString *outNames = (epicsOldString *)prec->vale;
+    epicsUInt16 *outRoot = (epicsUInt16 *)prec->valf;
+    epicsUInt16 *outSuppressed = (epicsUInt16 *)prec->valg;
+    void **states = &prec->valk;
+    ppt::InterlockSummary summary;
+    epicsInt32 numSuppressed = 0;
+    int i;
+
+    if (prec->nea < (epicsUInt32)ppt::kFrameBytes ||
+        prec->nova < (epicsUInt32)ppt::kNumInterlockWords ||
+        prec->novf < (epicsUInt32)ppt::kNumInterlockWords ||
+        prec->novg < (epicsUInt32)ppt::kNumInterlockWords)
+        return -1;
+
+    ppt::summarizeInterlocks(frame, (const epicsUInt8 *)prec->b, summary);
+    for (i = 0; i < ppt::kNumInterlockWords; i++)
+        outActive[i] = summary.active[i];
+    *outCount = summary.count;
+    *outSeverity = summary.severity;
+    *outSubsystems = summary.subsystems;
+
+    if (summary.numNames > (int)prec->nove)
+        summary.numNames = (int)prec->nove;
+    for (i = 0; i < summary.numNames; i++) {
+        strncpy(outNames[i], summary.names[i], sizeof(epicsOldString) - 1);
+        outNames[i][sizeof(epicsOldString) - 1] = '\0';
+    }
+    prec->neve = summary.numNames;
+
+    epicsMutexMustLock(pptCausalityLock);
+    pptCausality.evaluate(summary.active, outRoot, outSuppressed);
+    epicsMutexUnlock(pptCausalityLock);
+    for (i = 0; i < ppt::kNumInterlockWords; i++)
+        for (epicsUInt16 bits = outSuppressed[i]; bits; bits &= bits - 1)
+            numSuppressed++;
+    *(epicsInt32 *)prec->valj = numSuppressed;
+    prec->nevh = pptInterlockNames(outRoot, (epicsOldString *)prec->valh, prec->novh);
+    prec->nevi = pptInterlockNames(outSuppressed, (epicsOldString *)prec->vali, prec->novi);
+
+    for (i = 0; i < ppt::kNumInterlockWords; i++)
+        *(epicsUInt32 *)states[i] = summary.active[i] | (epicsUInt32)outSuppressed[i] << 16;
+    return 0;
+}
+
+/* Frame and word statistics of one record, called with its lock held */
+static void printWordStats(const char *name, epicsUInt32 frames, epicsUInt32 rejected,
+                           const epicsUInt16 *words, const epicsUInt32 *changes,
+                           const double *lastChange, const epicsUInt32 *violations,
+                           int level) {
+    int moving = 0;
+    int w;
+
+    for (w = 0; w < ppt::kFrameWords; w++)
+        moving += changes[w] != 0;
+    printf("%s: %u frames, %u rejected, %d/%d words changed\n",
+           name, frames, rejected, moving, ppt::kFrameWords);
+
+    if (level < 1)
+        return;
+    printf("  word name                        raw   changes  violations  last change\n");
+    for (w = 0; w < ppt::kFrameWords; w++) {
+        char when[40] = "never";
+        if (changes[w]) {
+            epicsTimeStamp ts;
+            epicsTimeFromTime_t(&ts, (time_t)lastChange[w]);
+            ts.nsec = (epicsUInt32)((lastChange[w] - floor(lastChange[w])) * 1e9);
+            epicsTimeToStrftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S.%03f", &ts);
+        }
+        printf("  %4d %-26s 0x%04X %9u %11u  %s\n", w, ppt::wordMap[w].name,
+               words[w], changes[w], violations[w], when);
+    }
+}
+
+/*
+ * pptReport level
+ * 
+ * Prints frame and word statistics of every pptFrame record
+ * (Snapshot:Frame of ppt.template, Frame of ppt_frame.template).
+ * level 0: summary, level 1: per-word table
+ */
+static void pptReport(int level) {
+    DBENTRY entry;
+    long status;
+
+    if (!pdbbase)
+        return;
+    dbInitEntry(pdbbase, &entry);
+    if (dbFindRecordType(&entry, "pptFrame") == 0) {
+        for (status = dbFirstRecord(&entry); !status; status = dbNextRecord(&entry)) {
+            pptFrameRecord *prec;
+
+            if (dbIsAlias(&entry))
+                continue;
+            prec = (pptFrameRecord *)entry.precnode->precord;
+            dbScanLock((dbCommon *)prec);
+            printWordStats(prec->name, prec->nfrm, prec->nrej, prec->wrds, prec->wchg,
+                           prec->wlct, prec->viol, level);
+            dbScanUnlock((dbCommon *)prec);
+        }
+    }
+    dbFinishEntry(&entry);
+}
+
+static const iocshArg pptReportArg0 = { "level", iocshArgInt };
+static const iocshArg * const pptReportArgs[] = { &pptReportArg0 };
+static const iocshFuncDef pptReportFuncDef = { "pptReport", 1, pptReportArgs };
+
+static void pptReportCallFunc(const iocshArgBuf *args) {
+    pptReport(args[0].ival);
+}
+
+/*
+ * pptCausalityLoad filename
+ *
+ * Loads the interlock causality graph (format in pptCausality.h) used by
+ * all pptInterlockSummary records; an empty name removes it.
+ */
+static void pptCausalityLoad(const char *filename) {
+    ppt::CausalityGraph *graph = new ppt::CausalityGraph;
+    int edges = 0;
+
+    if (filename && *filename)
+        edges = graph->load(filename);
+    epicsMutexMustLock(pptCausalityLock);
+    pptCausality = *graph;
+    epicsMutexUnlock(pptCausalityLock);
+    delete graph;
+    if (!filename || !*filename)
+        return;
+    if (edges < 0)
+        printf("pptCausalityLoad: cannot load %s, no suppression\n", filename);
+    else
+        printf("pptCausalityLoad: %s, %d edges\n", filename, edges);
+}
+
+static const iocshArg pptCausalityLoadArg0 = { "filename", iocshArgString };
+static const iocshArg * const pptCausalityLoadArgs[] = { &pptCausalityLoadArg0 };
+static const iocshFuncDef pptCausalityLoadFuncDef = { "pptCausalityLoad", 1, pptCausalityLoadArgs };
+
+static void pptCausalityLoadCallFunc(const iocshArgBuf *args) {
+    pptCausalityLoad(args[0].sval);
+}
+
+static void pptDecodeRegister(void) {
+    pptCausalityLock = epicsMutexMustCreate();
+    iocshRegister(&pptReportFuncDef, pptReportCallFunc);
+    iocshRegister(&pptCausalityLoadFuncDef, pptCausalityLoadCallFunc);
+}
+
+/* Register the functions */
+epicsExportRegistrar(pptDecodeRegister);
+epicsRegisterFunction(pptInterlockSummary);
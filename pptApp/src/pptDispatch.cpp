@@ -0,0 +1,251 @@
+/*
+ * pptDispatch.cpp
+ *
+ * aSub record subroutines that process the records derived from a decoded
+ * frame, skipping the ones nobody is looking at
+ *
+ * Records are attached to a dispatcher with info tags:
+ *
+ *   info(pptDispatch, "$(P):$(R):Dispatch")   processed by that dispatcher
+ *   info(pptLazy, "YES")                      ... only when subscribed
+ *
+ * The dispatcher runs at the end of the frame chain (FLNK). It processes
+ * every dispatched record in load order, eager records first, so the raw
+ * status/interlock words are up to date before the bit records read them.
+ * A lazy record is processed when it has at least one monitor (CA, PVA,
+ * CP link or sequencer), and otherwise every RefreshFrames frames so that
+ * a plain get never returns a value older than that. A new subscriber is
+ * picked up at the next frame. RefreshFrames = 0 processes every record
+ * every frame.
+ *
+ * The dispatched records of a frame are updated as one transaction.
+ * Records that share the dispatcher's lock set (the normal case: NPP
+ * links back to the decoded frame) are processed synchronously, while the
+ * frame chain still holds that lock. Any other dispatched record is
+ * processed in one callback per frame, which takes the lock sets of all
+ * of them with a single dbScanLockMany(). Clients therefore never see part
+ * of a frame in these records, and the frame does not take one lock per
+ * record.
+ *
+ * That covers the dispatched records only. The measurement channels of
+ * pptDriver are asyn I/O Intr records: each is processed under its own
+ * lock when the driver posts its parameter, so a client may see them and
+ * the dispatched records from neighbouring frames. The whole frame in one
+ * update is Snapshot:Frame (ppt_snapshot.template).
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include <epicsTypes.h>
+#include <epicsString.h>
+#include <epicsMutex.h>
+#include <callback.h>
+#include <ellLib.h>
+#include <dbAccess.h>
+#include <dbStaticLib.h>
+#include <dbLock.h>
+#include <dbCommon.h>
+#include <epicsExport.h>
+#include <aSubRecord.h>
+#include <registryFunction.h>
+
+namespace {
+
+struct DispatchEntry {
+    dbCommon *precord;
+    bool lazy;
+    bool sameLockSet;
+    size_t remoteIndex;     /* in DispatchList::remote unless sameLockSet */
+    epicsUInt32 age;        /* frames since the record was last processed */
+};
+
+struct DispatchList {
+    std::vector<DispatchEntry> entries;
+    epicsUInt32 numLazy;
+    bool lockSetsKnown;
+
+    /* Records outside the dispatcher's lock set, processed by batchCallback */
+    std::vector<dbCommon *> remote;
+    std::vector<char> due;          /* remote[i] to process, guarded by batchLock */
+    std::vector<char> running;      /* callback's copy of due */
+    dbLocker *locker;
+    epicsMutexId batchLock;
+    bool batchQueued;
+    epicsCallback batch;
+};
+
+bool eagerFirst(const DispatchEntry &a, const DispatchEntry &b)
+{
+    return !a.lazy && b.lazy;
+}
+
+bool hasSubscribers(dbCommon *precord)
+{
+    int count;
+
+    epicsMutexMustLock(precord->mlok);
+    count = ellCount(&precord->mlis);
+    epicsMutexUnlock(precord->mlok);
+    return count > 0;
+}
+
+/* Process the due remote records of a frame under one batched lock */
+void batchCallback(epicsCallback *pcallback)
+{
+    void *user;
+    size_t i;
+
+    callbackGetUser(user, pcallback);
+    DispatchList *list = (DispatchList *)user;
+
+    epicsMutexMustLock(list->batchLock);
+    list->running.swap(list->due);
+    list->batchQueued = false;
+    epicsMutexUnlock(list->batchLock);
+
+    dbScanLockMany(list->locker);
+    for (i = 0; i < list->remote.size(); i++)
+        if (list->running[i])
+            dbProcess(list->remote[i]);
+    dbScanUnlockMany(list->locker);
+
+    std::fill(list->running.begin(), list->running.end(), 0);
+}
+
+} // namespace
+
+/*
+ * pptDispatchInit
+ *
+ * Collects the records whose pptDispatch info tag names this record.
+ */
+static long pptDispatchInit(aSubRecord *prec) {
+    DispatchList *list = new DispatchList;
+    DBENTRY entry;
+    long status;
+
+    list->numLazy = 0;
+    list->lockSetsKnown = false;
+    list->locker = NULL;
+    list->batchLock = epicsMutexMustCreate();
+    list->batchQueued = false;
+    callbackSetCallback(batchCallback, &list->batch);
+    callbackSetPriority(priorityMedium, &list->batch);
+    callbackSetUser(list, &list->batch);
+
+    dbInitEntry(pdbbase, &entry);
+    for (status = dbFirstRecordType(&entry); !status; status = dbNextRecordType(&entry)) {
+        long rstatus;
+        for (rstatus = dbFirstRecord(&entry); !rstatus; rstatus = dbNextRecord(&entry)) {
+            DispatchEntry de;
+
+            if (dbIsAlias(&entry))
+                continue;
+            if (dbFindInfo(&entry, "pptDispatch") ||
+                strcmp(dbGetInfoString(&entry), prec->name) != 0)
+                continue;
+
+            de.precord = (dbCommon *)entry.precnode->precord;
+            de.lazy = !dbFindInfo(&entry, "pptLazy") &&
+                      epicsStrCaseCmp(dbGetInfoString(&entry), "YES") == 0;
+            de.sameLockSet = false;
+            de.remoteIndex = 0;
+            de.age = 0;
+            list->numLazy += de.lazy;
+            list->entries.push_back(de);
+        }
+    }
+    dbFinishEntry(&entry);
+
+    std::stable_sort(list->entries.begin(), list->entries.end(), eagerFirst);
+    prec->dpvt = list;
+    return 0;
+}
+
+/*
+ * pptDispatch
+ *
+ * INPA: Refresh interval of lazy records without subscribers, in frames (LONG)
+ *
+ * VALA: Channels computed in this frame (LONG)
+ * VALB: Dispatched channels (LONG)
+ * VALC: Lazy channels (LONG)
+ * VALD: Lazy channels with subscribers (LONG)
+ */
+static long pptDispatch(aSubRecord *prec) {
+    DispatchList *list = (DispatchList *)prec->dpvt;
+    epicsInt32 refresh = *(epicsInt32 *)prec->a;
+    epicsInt32 *outComputed = (epicsInt32 *)prec->vala;
+    epicsInt32 *outChannels = (epicsInt32 *)prec->valb;
+    epicsInt32 *outLazy = (epicsInt32 *)prec->valc;
+    epicsInt32 *outSubscribed = (epicsInt32 *)prec->vald;
+    epicsInt32 computed = 0, subscribed = 0;
+    bool remoteDue = false;
+    size_t i;
+
+    if (!list)
+        return -1;
+
+    /* Lock sets are final once the IOC runs */
+    if (!list->lockSetsKnown) {
+        unsigned long myLockId = dbLockGetLockId((dbCommon *)prec);
+        for (i = 0; i < list->entries.size(); i++) {
+            DispatchEntry &de = list->entries[i];
+            de.sameLockSet = dbLockGetLockId(de.precord) == myLockId;
+            if (!de.sameLockSet) {
+                de.remoteIndex = list->remote.size();
+                list->remote.push_back(de.precord);
+            }
+        }
+        if (!list->remote.empty()) {
+            printf("%s: %u dispatched records in other lock sets, batched\n",
+                   prec->name, (unsigned)list->remote.size());
+            list->due.assign(list->remote.size(), 0);
+            list->running.assign(list->remote.size(), 0);
+            list->locker = dbLockerAlloc(&list->remote[0], list->remote.size(), 0);
+        }
+        list->lockSetsKnown = true;
+    }
+
+    if (list->locker)
+        epicsMutexMustLock(list->batchLock);
+
+    for (i = 0; i < list->entries.size(); i++) {
+        DispatchEntry &de = list->entries[i];
+
+        if (de.lazy) {
+            bool active = hasSubscribers(de.precord);
+            subscribed += active;
+            if (!active && refresh > 0 && ++de.age < (epicsUInt32)refresh)
+                continue;
+        }
+        de.age = 0;
+        computed++;
+        if (de.sameLockSet) {
+            dbProcess(de.precord);
+        } else {
+            list->due[de.remoteIndex] = 1;
+            remoteDue = true;
+        }
+    }
+
+    if (list->locker) {
+        /* A frame not yet published is merged into this one */
+        if (remoteDue && !list->batchQueued)
+            list->batchQueued = callbackRequest(&list->batch) == 0;
+        epicsMutexUnlock(list->batchLock);
+    }
+
+    *outComputed = computed;
+    *outChannels = (epicsInt32)list->entries.size();
+    *outLazy = (epicsInt32)list->numLazy;
+    *outSubscribed = subscribed;
+    return 0;
+}
+
+/* Register the functions */
+epicsRegisterFunction(pptDispatchInit);
+epicsRegisterFunction(pptDispatch);
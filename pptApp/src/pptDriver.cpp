@@ -0,0 +1,686 @@
+/*
+ * pptDriver.cpp
+ *
+ * asyn port driver publishing the decoded channels as asyn parameters
+ *
+ *   pptDriverConfigure(portName, ioPortName, trendDepth)
+ *
+ * A reader thread takes the byte stream from the asyn IP port ioPortName
+ * (drvAsynIPPortConfigure), splits it into frames with ppt::Framer and
+ * sets one parameter per channel of channelMap (pptProto.h), named like
+ * the PV suffix, e.g. drvInfo "Thy:HeaterVoltage": asynFloat64 for the
+ * measurements, asynInt32 for timers and status/interlock words.
+ * callParamCallbacks() runs once per frame and posts only the parameters
+ * whose value or alarm changed, so "I/O Intr" records process on change.
+ * Channels of a word that failed validation carry the usual invalid value
+ * (NaN, or raw + 65536) with READ/INVALID alarm; when the connection drops
+ * or no frame arrives for kStaleTimeout, all channels go COMM/INVALID.
+ *
+ * Deadbands: an analog channel is posted only when it moved more than abs
+ * and rel * |last posted|, at most maxRate times per second; a change of
+ * validity is always posted. Set by info(pptDeadband, "abs [rel [maxRate]]")
+ * on the channel record or with pptDeadband; "asynReport 1 portName" lists
+ * them with the updates held back.
+ *
+ * Besides the channels: RawFrame (feeds RawData), the framer statistics,
+ * the interlock summary of ppt_lean.template (Interlock:*) and one
+ * Agg:<Sub>:* array set per subsystem for displays, posted when one of
+ * its channels was. Trends, latch and SOE are in pptDriverHistory.cpp,
+ * the command engine in pptDriverCommand.cpp.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <alarm.h>
+#include <dbAccess.h>
+#include <dbStaticLib.h>
+#include <initHooks.h>
+#include <iocsh.h>
+#include <asynPortDriver.h>
+#include <asynOctetSyncIO.h>
+#include <epicsExport.h>
+
+#include "pptDriver.h"
+
+static const char *driverName = "pptDriver";
+
+static const double kReadTimeout = 0.05;    /* one read, bounds a command's wait */
+static const double kStaleTimeout = 2.0;    /* no frame: disconnected */
+static const int kReadChunk = 256;
+static const int kTrendDepth = 3600;        /* default samples per trend */
+
+static void readerTaskC(void *drvPvt)
+{
+    ((pptDriver *)drvPvt)->readerTask();
+}
+
+pptDriver::pptDriver(const char *portName, const char *ioPortName, int trendDepth)
+    : asynPortDriver(portName, 1,
+                     asynInt32Mask | asynFloat64Mask | asynInt8ArrayMask | asynInt32ArrayMask |
+                     asynFloat64ArrayMask | asynOctetMask | asynDrvUserMask,
+                     asynInt32Mask | asynFloat64Mask | asynInt8ArrayMask | asynInt32ArrayMask |
+                     asynFloat64ArrayMask | asynOctetMask,
+                     0, 1, 0, 0),
+      pasynUserIO_(NULL), pasynUserCmd_(NULL), trendTime_(trendDepth), soe_(kSoeDepth),
+      frames_(0), suppressed_(0), connected_(false), commands_(kCommandQueue)
+{
+    const char *functionName = "pptDriver";
+    asynStatus status;
+
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        const ppt::ChannelInfo &info = ppt::channelMap[c];
+        createParam(info.name, info.kind == ppt::kAnalog ? asynParamFloat64 : asynParamInt32,
+                    &P_Channel[c]);
+    }
+    createParam("RawFrame", asynParamInt8Array, &P_RawFrame);
+    createParam("Quality:MaxFailures", asynParamInt32, &P_MaxFailures);
+    createParam("Stats:Frames", asynParamInt32, &P_Frames);
+    createParam("Stats:Resyncs", asynParamInt32, &P_Resyncs);
+    createParam("Stats:Suppressed", asynParamInt32, &P_Suppressed);
+    createParam("Connected", asynParamInt32, &P_Connected);
+    createParam("Interlock:Count", asynParamInt32, &P_IlkCount);
+    createParam("Interlock:Severity", asynParamInt32, &P_IlkSeverity);
+    createParam("Interlock:Subsystems", asynParamInt32, &P_IlkSubsystems);
+    createParam("Interlock:ActiveNames", asynParamOctet, &P_IlkNames);
+    createAggregates();
+    createHistory(trendDepth);
+    createCommandEngine();
+
+    setIntegerParam(P_MaxFailures, 4);
+    setIntegerParam(P_Frames, 0);
+    setIntegerParam(P_Resyncs, 0);
+    setIntegerParam(P_Suppressed, 0);
+    setIntegerParam(P_Connected, 0);
+    setIntegerParam(P_IlkCount, 0);
+    setIntegerParam(P_IlkSeverity, ppt::kInterlocksInvalid);
+    setIntegerParam(P_IlkSubsystems, 0);
+    setStringParam(P_IlkNames, "");
+    interlocksKnown_ = false;
+    memset(lastFrame_.bytes, 0, sizeof(lastFrame_.bytes));
+    memset(deadband_, 0, sizeof(deadband_));
+    for (int c = 0; c < ppt::kNumChannels; c++)
+        deadband_[c].posted = NAN;
+
+    status = pasynOctetSyncIO->connect(ioPortName, 0, &pasynUserIO_, NULL);
+    if (status == asynSuccess)
+        status = pasynOctetSyncIO->connect(ioPortName, 0, &pasynUserCmd_, NULL);
+    if (status) {
+        printf("%s:%s: cannot connect to asyn port %s\n", driverName, functionName, ioPortName);
+        return;
+    }
+
+    if (!epicsThreadCreate("pptDriver", epicsThreadPriorityMedium,
+                           epicsThreadGetStackSize(epicsThreadStackMedium),
+                           readerTaskC, this) ||
+        !startCommandTask())
+        printf("%s:%s: epicsThreadCreate failed\n", driverName, functionName);
+}
+
+asynStatus pptDriver::writeInt32(asynUser *pasynUser, epicsInt32 value)
+{
+    int function = pasynUser->reason;
+
+    if (function == P_MaxFailures) {
+        if (value < 0)
+            return asynError;
+        framer_.setMaxFailures(value);
+        setIntegerParam(P_MaxFailures, value);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function >= P_Latched[0] && function <= P_TrendBytes)
+        return writeHistoryInt32(pasynUser, value);
+    if (function >= P_Cmd[0] && function <= P_Pulses)
+        return writeCommandInt32(pasynUser, value);
+    return asynPortDriver::writeInt32(pasynUser, value);
+}
+
+asynStatus pptDriver::writeFloat64(asynUser *pasynUser, epicsFloat64 value)
+{
+    int function = pasynUser->reason;
+
+    if (function >= P_Latched[0] && function <= P_TrendBytes)
+        return writeHistoryFloat64(pasynUser, value);
+    if (function >= P_Cmd[0] && function <= P_Pulses)
+        return writeCommandFloat64(pasynUser, value);
+    return asynPortDriver::writeFloat64(pasynUser, value);
+}
+
+/* quality: flags the framer validated the frame with */
+void pptDriver::publishFrame(const ppt::FrameBuffer &frame, const uint8_t *quality,
+                             const epicsTimeStamp &rxTime)
+{
+    ppt::FrameView view = frame.view();
+    double posixTime = rxTime.secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH + rxTime.nsec * 1e-9;
+
+    if (!connected_)
+        setConnected(true, NO_ALARM);
+    closeTrendPeriod(posixTime);
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        const ppt::ChannelInfo &info = ppt::channelMap[c];
+        double value = ppt::channelValue(view, c, quality);
+        int param = P_Channel[c];
+        bool valid = !quality[info.word];
+
+        Aggregate &agg = aggregates_[aggOf_[c]];
+        int pos = aggPos_[c];
+
+        if (info.kind == ppt::kAnalog) {
+            if (valid && !isnan(value)) {
+                trendSum_[c] += value;
+                trendValues_[c]++;
+            }
+            if (passDeadband(c, value, rxTime)) {
+                setDoubleParam(param, value);
+                agg.valueBuf[pos] = value;
+                agg.changed = true;
+            }
+        } else {
+            setIntegerParam(param, (epicsInt32)value);
+            if (info.kind == ppt::kBits && agg.wordBuf[pos] != (epicsInt32)value) {
+                agg.wordBuf[pos] = (epicsInt32)value;
+                agg.changed = true;
+            } else if (info.kind == ppt::kInteger && !(agg.valueBuf[pos] == value)) {
+                agg.valueBuf[pos] = value;
+                agg.changed = true;
+            }
+        }
+        agg.invalid |= !valid;
+        setParamStatus(param, valid ? asynSuccess : asynError);
+        setParamAlarmStatus(param, valid ? NO_ALARM : READ_ALARM);
+        setParamAlarmSeverity(param, valid ? NO_ALARM : INVALID_ALARM);
+    }
+
+    publishAggregates(false);
+
+    latch_.update(view, quality, posixTime);
+    publishLatch();
+    publishInterlocks(view, quality);
+    checkRoundTrips(&view, quality, monotonicSeconds());
+    updateRamp(view, quality, monotonicSeconds());
+
+    frames_++;
+    if (soe_.update(view, quality, posixTime, (uint32_t)frames_))
+        publishSoe();
+
+    setIntegerParam(P_Frames, frames_);
+    setIntegerParam(P_Suppressed, suppressed_);
+    setIntegerParam(P_Resyncs, (epicsInt32)framer_.resyncs());
+    lastFrame_ = frame;
+    doCallbacksInt8Array((epicsInt8 *)lastFrame_.bytes, ppt::kFrameBytes, P_RawFrame, 0);
+    callParamCallbacks();
+}
+
+/* Whether the analog channel's new value is to be posted */
+bool pptDriver::passDeadband(int channel, double value, const epicsTimeStamp &rxTime)
+{
+    Deadband &db = deadband_[channel];
+
+    /* NaN never compares equal: post validity changes, keep invalid quiet */
+    if (isnan(value) || isnan(db.posted)) {
+        if (isnan(value) && isnan(db.posted))
+            return false;
+    } else {
+        double delta = fabs(value - db.posted);
+
+        if (delta == 0.0) {
+            db.pending = false;
+            return false;
+        }
+        if (!db.pending && (delta <= db.abs || delta <= db.rel * fabs(db.posted))) {
+            db.suppressed++;
+            suppressed_++;
+            return false;
+        }
+        if (db.minInterval > 0.0 &&
+            epicsTimeDiffInSeconds(&rxTime, &db.postTime) < db.minInterval) {
+            db.pending = true;
+            db.suppressed++;
+            suppressed_++;
+            return false;
+        }
+    }
+    db.posted = value;
+    db.postTime = rxTime;
+    db.pending = false;
+    return true;
+}
+
+asynStatus pptDriver::setDeadband(const char *channel, double abs, double rel, double maxRate)
+{
+    bool all = strcmp(channel, "*") == 0;
+    bool found = false;
+
+    if (abs < 0.0 || rel < 0.0 || maxRate < 0.0)
+        return asynError;
+    lock();
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        const ppt::ChannelInfo &info = ppt::channelMap[c];
+
+        if (info.kind != ppt::kAnalog || (!all && strcmp(channel, info.name) != 0))
+            continue;
+        deadband_[c].abs = abs;
+        deadband_[c].rel = rel;
+        deadband_[c].minInterval = maxRate > 0.0 ? 1.0 / maxRate : 0.0;
+        found = true;
+    }
+    unlock();
+    return found ? asynSuccess : asynError;
+}
+
+void pptDriver::report(FILE *fp, int details)
+{
+    asynPortDriver::report(fp, details);
+    if (details < 1)
+        return;
+    fprintf(fp, "  channel                      abs        rel   maxRate  suppressed\n");
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        const Deadband &db = deadband_[c];
+
+        if (ppt::channelMap[c].kind != ppt::kAnalog)
+            continue;
+        fprintf(fp, "  %-24s %9g %9g %9g %11lu\n", ppt::channelMap[c].name, db.abs, db.rel,
+                db.minInterval > 0.0 ? 1.0 / db.minInterval : 0.0, db.suppressed);
+    }
+    reportHistory(fp);
+    reportCommands(fp);
+}
+
+/* One aggregate per channel name prefix, in channelMap order */
+void pptDriver::createAggregates()
+{
+    std::vector<std::string> names;
+
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        const ppt::ChannelInfo &info = ppt::channelMap[c];
+        std::string name(info.name);
+        std::string sub = name.substr(0, name.find(':'));
+        size_t a;
+
+        for (a = 0; a < names.size() && names[a] != sub; a++)
+            ;
+        if (a == names.size()) {
+            names.push_back(sub);
+            aggregates_.push_back(Aggregate());
+        }
+        Aggregate &agg = aggregates_[a];
+        std::vector<int> &list = info.kind == ppt::kBits ? agg.words : agg.values;
+        aggOf_[c] = (int)a;
+        aggPos_[c] = (int)list.size();
+        list.push_back(c);
+    }
+
+    for (size_t a = 0; a < aggregates_.size(); a++) {
+        Aggregate &agg = aggregates_[a];
+        std::string prefix = "Agg:" + names[a] + ":";
+        std::string labels, bitNames;
+
+        agg.valueBuf.assign(agg.values.size(), NAN);
+        agg.wordBuf.assign(agg.words.size(), 0);
+        agg.changed = agg.invalid = agg.wasInvalid = false;
+        agg.P_Values = agg.P_Words = agg.P_Labels = agg.P_BitNames = -1;
+
+        for (size_t i = 0; i < agg.values.size(); i++) {
+            const ppt::ChannelInfo &info = ppt::channelMap[agg.values[i]];
+            const char *colon = strchr(info.name, ':');
+            if (i)
+                labels += ";";
+            labels += colon ? colon + 1 : info.name;
+            if (*info.units)
+                labels += std::string(" ") + info.units;
+        }
+        for (size_t i = 0; i < agg.words.size(); i++) {
+            int word = ppt::channelMap[agg.words[i]].word;
+            for (size_t n = 0; n < ppt::numBits; n++) {
+                const ppt::BitInfo &bit = ppt::bitMap[n];
+                const char *colon = strchr(bit.name, ':');
+                char entry[16];
+                if (bit.word != word)
+                    continue;
+                sprintf(entry, "%u.%d ", (unsigned)i, bit.bit);
+                if (!bitNames.empty())
+                    bitNames += ";";
+                bitNames += entry;
+                bitNames += colon ? colon + 1 : bit.name;
+            }
+        }
+
+        if (!agg.values.empty()) {
+            createParam((prefix + "Values").c_str(), asynParamFloat64Array, &agg.P_Values);
+            createParam((prefix + "Labels").c_str(), asynParamOctet, &agg.P_Labels);
+            setStringParam(agg.P_Labels, labels.c_str());
+        }
+        if (!agg.words.empty()) {
+            createParam((prefix + "Words").c_str(), asynParamInt32Array, &agg.P_Words);
+            createParam((prefix + "BitNames").c_str(), asynParamOctet, &agg.P_BitNames);
+            setStringParam(agg.P_BitNames, bitNames.c_str());
+        }
+    }
+}
+
+/* Post the aggregates with a posted channel or a change of validity */
+void pptDriver::publishAggregates(bool force)
+{
+    for (size_t a = 0; a < aggregates_.size(); a++) {
+        Aggregate &agg = aggregates_[a];
+        bool invalid = agg.invalid || !connected_;
+        int alarmStatus = connected_ ? READ_ALARM : COMM_ALARM;
+
+        if (!force && !agg.changed && invalid == agg.wasInvalid) {
+            agg.invalid = false;
+            continue;
+        }
+        int params[2] = { agg.P_Values, agg.P_Words };
+        for (int i = 0; i < 2; i++) {
+            if (params[i] < 0)
+                continue;
+            setParamStatus(params[i], invalid ? asynError : asynSuccess);
+            setParamAlarmStatus(params[i], invalid ? alarmStatus : NO_ALARM);
+            setParamAlarmSeverity(params[i], invalid ? INVALID_ALARM : NO_ALARM);
+        }
+        if (agg.P_Values >= 0)
+            doCallbacksFloat64Array(&agg.valueBuf[0], agg.valueBuf.size(), agg.P_Values, 0);
+        if (agg.P_Words >= 0)
+            doCallbacksInt32Array(&agg.wordBuf[0], agg.wordBuf.size(), agg.P_Words, 0);
+        agg.wasInvalid = invalid;
+        agg.changed = agg.invalid = false;
+    }
+}
+
+/* Interlock summary of the frame; the names only when the bits changed */
+void pptDriver::publishInterlocks(const ppt::FrameView &view, const uint8_t *quality)
+{
+    ppt::InterlockSummary summary;
+
+    ppt::summarizeInterlocks(view, quality, summary);
+    setIntegerParam(P_IlkCount, summary.count);
+    setIntegerParam(P_IlkSeverity, summary.severity);
+    setIntegerParam(P_IlkSubsystems, (epicsInt32)summary.subsystems);
+    if (!interlocksKnown_ ||
+        memcmp(summary.active, interlocks_.active, sizeof(summary.active)) != 0) {
+        std::string names;
+
+        for (int i = 0; i < summary.numNames; i++) {
+            if (i)
+                names += " ";
+            names += summary.names[i];
+        }
+        setStringParam(P_IlkNames, names.c_str());
+    }
+    interlocks_ = summary;
+    interlocksKnown_ = true;
+}
+
+/* Status of all channels and RawFrame after a connect or disconnect */
+void pptDriver::setConnected(bool connected, int alarmStatus)
+{
+    asynStatus status = connected ? asynSuccess : asynDisconnected;
+    int severity = connected ? NO_ALARM : INVALID_ALARM;
+
+    connected_ = connected;
+    setIntegerParam(P_Connected, connected);
+    if (connected) {
+        /* Arrays of I/O Intr records without a value yet */
+        publishCommands();
+        publishRoundTrips();
+    }
+    if (!connected) {
+        soe_.reset();
+        setIntegerParam(P_IlkSeverity, ppt::kInterlocksInvalid);
+        interlocksKnown_ = false;
+    }
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        setParamStatus(P_Channel[c], status);
+        setParamAlarmStatus(P_Channel[c], alarmStatus);
+        setParamAlarmSeverity(P_Channel[c], severity);
+    }
+    setParamStatus(P_RawFrame, status);
+    setParamAlarmStatus(P_RawFrame, alarmStatus);
+    setParamAlarmSeverity(P_RawFrame, severity);
+    if (!connected) {
+        publishAggregates(true);
+        /* Process RawData once so the alarm reaches the database */
+        doCallbacksInt8Array((epicsInt8 *)lastFrame_.bytes, ppt::kFrameBytes, P_RawFrame, 0);
+        callParamCallbacks();
+    }
+}
+
+void pptDriver::readerTask()
+{
+    char buf[kReadChunk];
+    epicsTimeStamp lastData, now;
+
+    epicsTimeGetCurrent(&lastData);
+    for (;;) {
+        size_t nRead = 0;
+        int eomReason = 0;
+        asynStatus status;
+
+        status = pasynOctetSyncIO->read(pasynUserIO_, buf, sizeof(buf), kReadTimeout,
+                                        &nRead, &eomReason);
+        epicsTimeGetCurrent(&now);
+
+        lock();
+        if (nRead > 0) {
+            ppt::FrameBuffer frame;
+            uint8_t quality[ppt::kFrameWords];
+
+            framer_.push((const uint8_t *)buf, nRead);
+            while (framer_.pop(frame, quality)) {
+                publishFrame(frame, quality, now);
+                lastData = now;
+            }
+        }
+        if (status != asynSuccess && status != asynTimeout) {
+            framer_.reset();
+            if (connected_)
+                setConnected(false, COMM_ALARM);
+        } else if (connected_ && epicsTimeDiffInSeconds(&now, &lastData) > kStaleTimeout) {
+            framer_.reset();
+            setConnected(false, TIMEOUT_ALARM);
+        }
+        checkRoundTrips(NULL, NULL, monotonicSeconds());
+        unlock();
+
+        /* Port down: asyn reconnects in the background */
+        if (status != asynSuccess && status != asynTimeout)
+            epicsThreadSleep(1.0);
+    }
+}
+
+/* iocsh: pptDriverConfigure portName ioPortName [trendDepth] */
+extern "C" int pptDriverConfigure(const char *portName, const char *ioPortName, int trendDepth)
+{
+    if (!portName || !ioPortName || trendDepth < 0) {
+        printf("Usage: pptDriverConfigure portName ioPortName [trendDepth]\n");
+        return -1;
+    }
+    new pptDriver(portName, ioPortName, trendDepth ? trendDepth : kTrendDepth);
+    return 0;
+}
+
+static pptDriver *findDriver(const char *portName)
+{
+    if (!portName)
+        return NULL;
+    return dynamic_cast<pptDriver *>((asynPortDriver *)findAsynPortDriver(portName));
+}
+
+/* iocsh: pptDeadband portName channel abs [rel] [maxRate] */
+extern "C" int pptDeadband(const char *portName, const char *channel, double abs,
+                           double rel, double maxRate)
+{
+    pptDriver *driver = findDriver(portName);
+
+    if (!driver || !channel) {
+        printf("Usage: pptDeadband portName channel|* abs [rel] [maxRate]\n");
+        return -1;
+    }
+    if (driver->setDeadband(channel, abs, rel, maxRate) != asynSuccess) {
+        printf("pptDeadband: %s is not an analog channel or a value is negative\n", channel);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Apply info(pptDeadband, "abs [rel [maxRate]]") of the records reading a
+ * channel of a pptDriver port, "@asyn(port,addr)channel"
+ */
+static void pptDeadbandInitHook(initHookState state)
+{
+    DBENTRY entry;
+    long status;
+
+    if (state != initHookAfterInitDatabase)
+        return;
+
+    dbInitEntry(pdbbase, &entry);
+    for (status = dbFirstRecordType(&entry); !status; status = dbNextRecordType(&entry)) {
+        long rstatus;
+        for (rstatus = dbFirstRecord(&entry); !rstatus; rstatus = dbNextRecord(&entry)) {
+            char port[64], channel[64];
+            double abs = 0.0, rel = 0.0, maxRate = 0.0;
+            const char *inp;
+            pptDriver *driver;
+
+            if (dbIsAlias(&entry) || dbFindInfo(&entry, "pptDeadband"))
+                continue;
+            if (sscanf(dbGetInfoString(&entry), "%lf %lf %lf", &abs, &rel, &maxRate) < 1 ||
+                dbFindField(&entry, "INP") || !(inp = dbGetString(&entry)) ||
+                sscanf(inp, " @asyn(%63[^,)]%*[^)])%63s", port, channel) != 2 ||
+                !(driver = findDriver(port)))
+                continue;
+            if (driver->setDeadband(channel, abs, rel, maxRate) != asynSuccess)
+                printf("pptDeadband: %s: bad info(pptDeadband)\n", dbGetRecordName(&entry));
+        }
+    }
+    dbFinishEntry(&entry);
+}
+
+/* iocsh: pptRoundTripFile portName filename */
+extern "C" int pptRoundTripFile(const char *portName, const char *filename)
+{
+    pptDriver *driver = findDriver(portName);
+
+    if (!driver || !filename || !*filename) {
+        printf("Usage: pptRoundTripFile portName filename, portName of pptDriverConfigure\n");
+        return -1;
+    }
+    printf("pptRoundTripFile: %d command histograms loaded from %s\n",
+           driver->setRoundTripFile(filename), filename);
+    return 0;
+}
+
+/* iocsh: pptCommandJournal portName filename [capacity] */
+extern "C" int pptCommandJournal(const char *portName, const char *filename, int capacity)
+{
+    pptDriver *driver = findDriver(portName);
+
+    if (!driver || !filename || !*filename || capacity < 0) {
+        printf("Usage: pptCommandJournal portName filename [capacity], "
+               "portName of pptDriverConfigure\n");
+        return -1;
+    }
+    return driver->setJournalFile(filename, capacity) ? 0 : -1;
+}
+
+/* iocsh: pptSoeDump portName [count] */
+extern "C" int pptSoeDump(const char *portName, int count)
+{
+    pptDriver *driver = findDriver(portName);
+
+    if (!driver) {
+        printf("Usage: pptSoeDump portName [count], portName of pptDriverConfigure\n");
+        return -1;
+    }
+    driver->dumpSoe(count);
+    return 0;
+}
+
+static const iocshArg pptDriverConfigureArg0 = { "portName", iocshArgString };
+static const iocshArg pptDriverConfigureArg1 = { "ioPortName", iocshArgString };
+static const iocshArg pptDriverConfigureArg2 = { "trendDepth", iocshArgInt };
+static const iocshArg * const pptDriverConfigureArgs[] = {
+    &pptDriverConfigureArg0, &pptDriverConfigureArg1, &pptDriverConfigureArg2
+};
+static const iocshFuncDef pptDriverConfigureFuncDef = {
+    "pptDriverConfigure", 3, pptDriverConfigureArgs
+};
+
+static void pptDriverConfigureCallFunc(const iocshArgBuf *args)
+{
+    pptDriverConfigure(args[0].sval, args[1].sval, args[2].ival);
+}
+
+static const iocshArg pptSoeDumpArg0 = { "portName", iocshArgString };
+static const iocshArg pptSoeDumpArg1 = { "count", iocshArgInt };
+static const iocshArg * const pptSoeDumpArgs[] = { &pptSoeDumpArg0, &pptSoeDumpArg1 };
+static const iocshFuncDef pptSoeDumpFuncDef = { "pptSoeDump", 2, pptSoeDumpArgs };
+
+static void pptSoeDumpCallFunc(const iocshArgBuf *args)
+{
+    pptSoeDump(args[0].sval, args[1].ival);
+}
+
+static const iocshArg pptDeadbandArg0 = { "portName", iocshArgString };
+static const iocshArg pptDeadbandArg1 = { "channel", iocshArgString };
+static const iocshArg pptDeadbandArg2 = { "abs", iocshArgDouble };
+static const iocshArg pptDeadbandArg3 = { "rel", iocshArgDouble };
+static const iocshArg pptDeadbandArg4 = { "maxRate", iocshArgDouble };
+static const iocshArg * const pptDeadbandArgs[] = {
+    &pptDeadbandArg0, &pptDeadbandArg1, &pptDeadbandArg2, &pptDeadbandArg3, &pptDeadbandArg4
+};
+static const iocshFuncDef pptDeadbandFuncDef = { "pptDeadband", 5, pptDeadbandArgs };
+
+static void pptDeadbandCallFunc(const iocshArgBuf *args)
+{
+    pptDeadband(args[0].sval, args[1].sval, args[2].dval, args[3].dval, args[4].dval);
+}
+
+static const iocshArg pptRoundTripFileArg0 = { "portName", iocshArgString };
+static const iocshArg pptRoundTripFileArg1 = { "filename", iocshArgString };
+static const iocshArg * const pptRoundTripFileArgs[] = {
+    &pptRoundTripFileArg0, &pptRoundTripFileArg1
+};
+static const iocshFuncDef pptRoundTripFileFuncDef = {
+    "pptRoundTripFile", 2, pptRoundTripFileArgs
+};
+
+static void pptRoundTripFileCallFunc(const iocshArgBuf *args)
+{
+    pptRoundTripFile(args[0].sval, args[1].sval);
+}
+
+static const iocshArg pptCommandJournalArg0 = { "portName", iocshArgString };
+static const iocshArg pptCommandJournalArg1 = { "filename", iocshArgString };
+static const iocshArg pptCommandJournalArg2 = { "capacity", iocshArgInt };
+static const iocshArg * const pptCommandJournalArgs[] = {
+    &pptCommandJournalArg0, &pptCommandJournalArg1, &pptCommandJournalArg2
+};
+static const iocshFuncDef pptCommandJournalFuncDef = {
+    "pptCommandJournal", 3, pptCommandJournalArgs
+};
+
+static void pptCommandJournalCallFunc(const iocshArgBuf *args)
+{
+    pptCommandJournal(args[0].sval, args[1].sval, args[2].ival);
+}
+
+static void pptDriverRegister(void)
+{
+    iocshRegister(&pptDriverConfigureFuncDef, pptDriverConfigureCallFunc);
+    iocshRegister(&pptSoeDumpFuncDef, pptSoeDumpCallFunc);
+    iocshRegister(&pptDeadbandFuncDef, pptDeadbandCallFunc);
+    iocshRegister(&pptRoundTripFileFuncDef, pptRoundTripFileCallFunc);
+    iocshRegister(&pptCommandJournalFuncDef, pptCommandJournalCallFunc);
+    initHookRegister(pptDeadbandInitHook);
+    initHookRegister(pptCommandInitHook);
+}
+epicsExportRegistrar(pptDriverRegister);
@@ -0,0 +1,288 @@
+/*
+ * pptDriver.h
+ *
+ * asyn port driver of the PPT Modulator, private to pptsup. The class is
+ * implemented in three parts:
+ *   pptDriver.cpp          frames, channels, deadbands, aggregates, iocsh
+ *   pptDriverHistory.cpp   trends, interlock latch, sequence of events
+ *   pptDriverCommand.cpp   command engine: queue, coalescing, pulses,
+ *                          round trips, HV ramp and journal
+ */
+
+#ifndef PPTDRIVER_H
+#define PPTDRIVER_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <epicsEvent.h>
+#include <epicsTime.h>
+#include <initHooks.h>
+#include <asynPortDriver.h>
+
+#include "pptProto.h"
+#include "pptFramer.h"
+#include "pptSoe.h"
+#include "pptInterlocks.h"
+#include "pptTrend.h"
+#include "pptCommand.h"
+#include "pptLatency.h"
+#include "pptRamp.h"
+#include "pptJournal.h"
+
+static const int kSoeDepth = 512;           /* edges kept by the SOE log */
+static const int kCommandQueue = 64;        /* commands waiting at most */
+
+inline double monotonicSeconds()
+{
+    return epicsMonotonicGet() * 1e-9;
+}
+
+/* initHook of the command engine, registered by pptDriverRegister */
+void pptCommandInitHook(initHookState state);
+
+class pptDriver : public asynPortDriver {
+public:
+    pptDriver(const char *portName, const char *ioPortName, int trendDepth);
+
+    virtual asynStatus writeInt32(asynUser *pasynUser, epicsInt32 value);
+    virtual asynStatus writeFloat64(asynUser *pasynUser, epicsFloat64 value);
+    virtual void report(FILE *fp, int details);
+
+    asynStatus setDeadband(const char *channel, double abs, double rel, double maxRate);
+    int setRoundTripFile(const char *filename);
+    bool setJournalFile(const char *filename, size_t capacity);
+
+    void readerTask();
+    void commandTask();
+    void roundTripTask();
+    void dumpSoe(int count);
+
+private:
+    /* pptDriver.cpp */
+    void publishFrame(const ppt::FrameBuffer &frame, const uint8_t *quality,
+                      const epicsTimeStamp &rxTime);
+    void publishInterlocks(const ppt::FrameView &view, const uint8_t *quality);
+    bool passDeadband(int channel, double value, const epicsTimeStamp &rxTime);
+    void createAggregates();
+    void publishAggregates(bool force);
+    void setConnected(bool connected, int alarmStatus);
+
+    /* pptDriverHistory.cpp */
+    void createHistory(int trendDepth);
+    asynStatus writeHistoryInt32(asynUser *pasynUser, epicsInt32 value);
+    asynStatus writeHistoryFloat64(asynUser *pasynUser, epicsFloat64 value);
+    void reportHistory(FILE *fp);
+    void publishSoe();
+    void publishLatch();
+    void closeTrendPeriod(double time);
+    void pushTrendSample(double time, bool gap);
+    void publishTrends(size_t newSamples);
+
+    /* pptDriverCommand.cpp */
+    void createCommandEngine();
+    bool startCommandTask();
+    asynStatus writeCommandInt32(asynUser *pasynUser, epicsInt32 value);
+    asynStatus writeCommandFloat64(asynUser *pasynUser, epicsFloat64 value);
+    void reportCommands(FILE *fp);
+    asynStatus queueCommand(int command, int source);
+    void countCancelled(const std::vector<ppt::QueuedCommand> &cancelled, int command);
+    int putSource();
+    void journalResult(int command, int outcome, double now);
+    void clearCommandStats();
+    void publishCommands();
+    bool writeImage(uint32_t image);
+    void publishImage(uint32_t image, bool written);
+    void journalClear(uint32_t image, bool written, double now);
+    void startRoundTrip(int command, double sent, uint32_t image);
+    void checkRoundTrips(const ppt::FrameView *view, const uint8_t *quality, double now);
+    void publishRoundTrips();
+    bool saveRoundTrips();
+    void updateRamp(const ppt::FrameView &view, const uint8_t *quality, double now);
+    void publishRamp();
+
+    /* Channels, frame statistics and interlock summary */
+    int P_Channel[ppt::kNumChannels];
+    int P_RawFrame;
+    int P_MaxFailures;
+    int P_Frames;
+    int P_Resyncs;
+    int P_Suppressed;
+    int P_Connected;
+    int P_IlkCount;
+    int P_IlkSeverity;
+    int P_IlkSubsystems;
+    int P_IlkNames;
+
+    /* History, created by createHistory from P_Latched[0] to P_TrendBytes */
+    int P_Latched[ppt::kNumInterlockWords];
+    int P_Held[ppt::kNumInterlockWords];
+    int P_LatchAny;
+    int P_HoldTime;
+    int P_LatchAck;
+    int P_SoeTime;
+    int P_SoeBit;
+    int P_SoeEdge;
+    int P_SoeTrip;
+    int P_SoeFirstFault;
+    int P_SoeCount;
+    int P_SoeTrips;
+    int P_SoeTripped;
+    int P_SoeFirstFaults;
+    int P_SoeClear;
+    int P_Trend[ppt::kNumChannels];
+    int P_TrendTime;
+    int P_TrendPeriod;
+    int P_TrendDeltaOnly;
+    int P_TrendDepth;
+    int P_TrendCount;
+    int P_TrendBytes;
+
+    /* Command engine, created by createCommandEngine from P_Cmd[0] to P_Pulses */
+    int P_Cmd[ppt::kNumCommands];
+    int P_HVSet;
+    int P_CmdReg32;
+    int P_CmdSent;
+    int P_CmdErrors;
+    int P_CmdQueued;
+    int P_CmdCount;
+    int P_CmdLatency;
+    int P_CmdMaxLatency;
+    int P_CmdCancelled;
+    int P_CmdNames;
+    int P_CmdWait;
+    int P_CmdMaxWait;
+    int P_SafetyLatency;
+    int P_SafetyLimit;
+    int P_SafetyOverruns;
+    int P_RtCount;
+    int P_RtTimeouts;
+    int P_RtMin;
+    int P_RtMedian;
+    int P_RtP99;
+    int P_RtMax;
+    int P_RtSelect;
+    int P_RtHistogram;
+    int P_RtBuckets;
+    int P_RtPending;
+    int P_RtTimeout;
+    int P_RtClear;
+    int P_RampTarget;
+    int P_RampRate;
+    int P_RampStep;
+    int P_RampTolerance;
+    int P_RampConfirmTimeout;
+    int P_RampStepBack;
+    int P_RampControl;
+    int P_RampState;
+    int P_RampReason;
+    int P_RampProgress;
+    int P_RampEta;
+    int P_CmdClearStats;
+    int P_CoalesceWindow;
+    int P_Coalesced;
+    int P_PulseHold;
+    int P_Pulses;
+
+    asynUser *pasynUserIO_;
+    asynUser *pasynUserCmd_;        /* command writes, same IP port */
+    ppt::Framer framer_;
+    ppt::FrameBuffer lastFrame_;
+
+    /* Deadband and rate limit of one analog channel */
+    struct Deadband {
+        double abs;
+        double rel;
+        double minInterval;         /* 1 / maxRate, seconds */
+        double posted;              /* last value posted */
+        epicsTimeStamp postTime;
+        bool pending;               /* change held back by the rate limit */
+        unsigned long suppressed;
+    };
+    Deadband deadband_[ppt::kNumChannels];
+
+    /* Channels of one subsystem for the display aggregates */
+    struct Aggregate {
+        std::vector<int> values;        /* channelMap indices */
+        std::vector<int> words;
+        std::vector<epicsFloat64> valueBuf;
+        std::vector<epicsInt32> wordBuf;
+        int P_Values;
+        int P_Words;
+        int P_Labels;
+        int P_BitNames;
+        bool changed;
+        bool invalid;
+        bool wasInvalid;
+    };
+    std::vector<Aggregate> aggregates_;
+    int aggOf_[ppt::kNumChannels];      /* index in aggregates_ */
+    int aggPos_[ppt::kNumChannels];     /* index in its values or words */
+
+    /* Trends of the analog channels, trendOf_ = index in trends_ or -1 */
+    std::vector<ppt::TrendBuffer> trends_;
+    ppt::TrendBuffer trendTime_;
+    int trendOf_[ppt::kNumChannels];
+    double trendSum_[ppt::kNumChannels];
+    int trendValues_[ppt::kNumChannels];
+    double trendStart_;             /* start of the current period, 0: none */
+    double trendPeriod_;
+    bool trendDeltaOnly_;
+
+    ppt::SoeRecorder soe_;
+    ppt::InterlockLatch latch_;
+    ppt::InterlockSummary interlocks_;
+    bool interlocksKnown_;          /* interlocks_ was published */
+    epicsFloat64 soeTime_[kSoeDepth];
+    epicsInt32 soeBit_[kSoeDepth];
+    epicsInt32 soeEdge_[kSoeDepth];
+    epicsInt32 soeTrip_[kSoeDepth];
+    epicsInt32 soeFirstFault_[kSoeDepth];
+    epicsInt32 frames_;
+    epicsInt32 suppressed_;
+    bool connected_;
+
+    /* Command engine, commands_ and the statistics under the driver lock */
+    ppt::CommandQueue commands_;
+    epicsEventId commandEvent_;
+    uint16_t hvRaw_;                /* setpoint of the next image */
+    epicsInt32 cmdSent_;
+    epicsInt32 cmdErrors_;
+    epicsInt32 cmdCount_[ppt::kNumCommandKinds];
+    epicsFloat64 cmdLatency_[ppt::kNumCommandKinds];
+    epicsFloat64 cmdMaxLatency_[ppt::kNumCommandKinds];
+    epicsInt32 cmdCancelled_[ppt::kNumCommandKinds];
+    epicsFloat64 cmdWait_[ppt::kNumPriorities];
+    epicsFloat64 cmdMaxWait_[ppt::kNumPriorities];
+    double safetyLatency_;
+    double safetyLimit_;
+    epicsInt32 safetyOverruns_;
+    double coalesceWindow_;         /* ms */
+    epicsInt32 coalesced_;
+    double pulseHold_;              /* ms */
+    epicsInt32 pulses_;
+
+    /* Round trip of each command, under the driver lock */
+    struct RoundTrip {
+        ppt::CommandEffect effect;
+        bool known;                 /* the command has an effect */
+        bool pending;
+        double sent;                /* end of the write, monotonic s */
+        uint32_t image;             /* journal image number */
+    };
+    RoundTrip roundTrip_[ppt::kNumCommands];
+    ppt::LatencyHistogram histograms_[ppt::kNumCommands];
+    double rtTimeout_;
+    int rtSelect_;
+    std::string rtFile_;
+    bool rtDirty_;                  /* histograms changed since the save */
+
+    ppt::HVRamp ramp_;
+    uint16_t rampTarget_;           /* raw */
+    uint16_t rampMasks_[ppt::kFrameWords];  /* interlock bits that trip it */
+
+    ppt::CommandJournal journal_;   /* under the driver lock */
+};
+
+#endif /* PPTDRIVER_H */
@@ -0,0 +1,952 @@
+/*
+ * pptDriverCommand.cpp
+ *
+ * pptDriver (pptDriver.h): the command engine. The driver is the only
+ * writer of the 32-bit command register (pptProto.h, ON/OFF bits 0-15,
+ * HV setpoint in bits 16-31). A write of a command parameter or of
+ * HVPS:VoltageSet queues an entry (pptCommand.h); the pptCommand thread
+ * composes each image from the command bits and the setpoint at the time
+ * of sending and writes it in the writeFullCmd32 format. OFF and Reset go
+ * ahead of the queue and cancel the ON commands they supersede. The Cmd:*
+ * parameters count images, latencies, queue waits and errors.
+ *
+ * Coalescing: with Cmd:CoalesceWindow > 0 the commands put within the
+ * window after the first one of an image share it where pptCommand.h
+ * allows; the window never holds back an OFF or Reset.
+ *
+ * Pulses: the ON bits and Reset (ppt::kEdgeBits) act on their rising
+ * edge, so Cmd:PulseHold ms after an image with one of them the image is
+ * written again without them. The OFF bits are levels and stay set.
+ *
+ * Round trips: after a command is written, the frames are watched for
+ * the status transition it causes (ppt::commandEffect); the delay goes
+ * into a histogram per command (pptLatency.h), RoundTrip:Timeout without
+ * it counts as a timeout. pptRoundTripFile keeps the histograms in a file
+ * that a low priority thread rewrites every kRoundTripSave seconds.
+ *
+ * HV ramp (pptRamp.h): Ramp:* moves the setpoint to Ramp:Target in steps
+ * queued like setpoint writes, pausing on the interlocks of
+ * ppt::rampInterlockMasks.
+ *
+ * Journal (pptJournal.h): pptCommandJournal appends every command written
+ * and its round trip outcome to a memory-mapped file read by pptjournal.
+ * The Channel Access client of a put comes from an asTrapWrite listener,
+ * so it needs a TRAPWRITE rule (ppt.acf); without one every put is
+ * journaled as local, which iocInit reports.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <epicsEvent.h>
+#include <epicsThread.h>
+#include <epicsTime.h>
+#include <osiProcess.h>
+#include <alarm.h>
+#include <asLib.h>
+#include <asTrapWrite.h>
+#include <asynPortDriver.h>
+#include <asynOctetSyncIO.h>
+
+#include "pptDriver.h"
+
+static const char *driverName = "pptDriver";
+
+static const double kWriteTimeout = 1.0;    /* one command write, seconds */
+static const double kSafetyLimit = 100.0;   /* default Cmd:SafetyLimit, ms */
+static const double kRoundTripTimeout = 30.0;   /* default RoundTrip:Timeout, s */
+static const double kPulseHold = 100.0;     /* default Cmd:PulseHold, ms */
+static const double kRoundTripSave = 5.0;   /* period of the histogram file, s */
+
+/* iocInit has processed the PINI records: setpoint writes are sent */
+static bool commandsLive = false;
+
+/* Channel Access put in progress in this thread, for the journal */
+static epicsThreadPrivateId journalClient;
+static char journalIocClient[128];     /* user@host of this IOC */
+/* Access security calls journalTrapWrite: some rule has TRAPWRITE */
+static bool journalTrapped = false;
+
+static void commandTaskC(void *drvPvt)
+{
+    ((pptDriver *)drvPvt)->commandTask();
+}
+
+static void roundTripTaskC(void *drvPvt)
+{
+    ((pptDriver *)drvPvt)->roundTripTask();
+}
+
+/* POSIX time in ns of the monotonic time t */
+static uint64_t journalTime(double t)
+{
+    epicsTimeStamp now;
+    double posix;
+
+    epicsTimeGetCurrent(&now);
+    posix = now.secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH + now.nsec * 1e-9;
+    return (uint64_t)((posix - (monotonicSeconds() - t)) * 1e9);
+}
+
+static void journalTrapWrite(asTrapWriteMessage *pmessage, int after)
+{
+    epicsThreadPrivateSet(journalClient, after ? NULL : pmessage);
+}
+
+/* Command, round trip and ramp parameters */
+void pptDriver::createCommandEngine()
+{
+    for (int c = 0; c < ppt::kNumCommands; c++)
+        createParam(ppt::commandMap[c].name, asynParamInt32, &P_Cmd[c]);
+    createParam("HVPS:VoltageSet", asynParamFloat64, &P_HVSet);
+    createParam("CmdReg32", asynParamInt32, &P_CmdReg32);
+    createParam("Cmd:Sent", asynParamInt32, &P_CmdSent);
+    createParam("Cmd:Errors", asynParamInt32, &P_CmdErrors);
+    createParam("Cmd:Queued", asynParamInt32, &P_CmdQueued);
+    createParam("Cmd:Count", asynParamInt32Array, &P_CmdCount);
+    createParam("Cmd:Latency", asynParamFloat64Array, &P_CmdLatency);
+    createParam("Cmd:MaxLatency", asynParamFloat64Array, &P_CmdMaxLatency);
+    createParam("Cmd:Cancelled", asynParamInt32Array, &P_CmdCancelled);
+    createParam("Cmd:Names", asynParamOctet, &P_CmdNames);
+    createParam("Cmd:Wait", asynParamFloat64Array, &P_CmdWait);
+    createParam("Cmd:MaxWait", asynParamFloat64Array, &P_CmdMaxWait);
+    createParam("Cmd:SafetyLatency", asynParamFloat64, &P_SafetyLatency);
+    createParam("Cmd:SafetyLimit", asynParamFloat64, &P_SafetyLimit);
+    createParam("Cmd:SafetyOverruns", asynParamInt32, &P_SafetyOverruns);
+    createParam("RoundTrip:Count", asynParamInt32Array, &P_RtCount);
+    createParam("RoundTrip:Timeouts", asynParamInt32Array, &P_RtTimeouts);
+    createParam("RoundTrip:Min", asynParamFloat64Array, &P_RtMin);
+    createParam("RoundTrip:Median", asynParamFloat64Array, &P_RtMedian);
+    createParam("RoundTrip:P99", asynParamFloat64Array, &P_RtP99);
+    createParam("RoundTrip:Max", asynParamFloat64Array, &P_RtMax);
+    createParam("RoundTrip:Select", asynParamInt32, &P_RtSelect);
+    createParam("RoundTrip:Histogram", asynParamInt32Array, &P_RtHistogram);
+    createParam("RoundTrip:Buckets", asynParamFloat64Array, &P_RtBuckets);
+    createParam("RoundTrip:Pending", asynParamInt32, &P_RtPending);
+    createParam("RoundTrip:Timeout", asynParamFloat64, &P_RtTimeout);
+    createParam("RoundTrip:Clear", asynParamInt32, &P_RtClear);
+    createParam("Ramp:Target", asynParamFloat64, &P_RampTarget);
+    createParam("Ramp:Rate", asynParamFloat64, &P_RampRate);
+    createParam("Ramp:Step", asynParamFloat64, &P_RampStep);
+    createParam("Ramp:Tolerance", asynParamFloat64, &P_RampTolerance);
+    createParam("Ramp:ConfirmTimeout", asynParamFloat64, &P_RampConfirmTimeout);
+    createParam("Ramp:StepBack", asynParamFloat64, &P_RampStepBack);
+    createParam("Ramp:Control", asynParamInt32, &P_RampControl);
+    createParam("Ramp:State", asynParamInt32, &P_RampState);
+    createParam("Ramp:Reason", asynParamOctet, &P_RampReason);
+    createParam("Ramp:Progress", asynParamFloat64, &P_RampProgress);
+    createParam("Ramp:ETA", asynParamFloat64, &P_RampEta);
+    createParam("Cmd:ClearStats", asynParamInt32, &P_CmdClearStats);
+    createParam("Cmd:CoalesceWindow", asynParamFloat64, &P_CoalesceWindow);
+    createParam("Cmd:Coalesced", asynParamInt32, &P_Coalesced);
+    createParam("Cmd:PulseHold", asynParamFloat64, &P_PulseHold);
+    createParam("Cmd:Pulses", asynParamInt32, &P_Pulses);
+
+    hvRaw_ = 0;
+    safetyLimit_ = kSafetyLimit;
+    coalesceWindow_ = 0.0;
+    pulseHold_ = kPulseHold;
+    rtTimeout_ = kRoundTripTimeout;
+    rtSelect_ = 0;
+    rtDirty_ = false;
+    rampTarget_ = 0;
+
+    /* HVPS:VoltageSet stays undefined: the ao keeps its autosaved value */
+    std::string names;
+    for (int k = 0; k < ppt::kNumCommandKinds; k++)
+        names += std::string(k ? ";" : "") + ppt::commandKindName(k);
+    setStringParam(P_CmdNames, names.c_str());
+    setIntegerParam(P_CmdReg32, 0);
+    setDoubleParam(P_SafetyLimit, safetyLimit_);
+    setDoubleParam(P_CoalesceWindow, coalesceWindow_);
+    setDoubleParam(P_PulseHold, pulseHold_);
+    clearCommandStats();
+    for (int c = 0; c < ppt::kNumCommands; c++) {
+        roundTrip_[c].known = ppt::commandEffect(c, roundTrip_[c].effect);
+        roundTrip_[c].pending = false;
+        roundTrip_[c].image = 0;
+        roundTrip_[c].sent = 0.0;
+    }
+    setIntegerParam(P_RtSelect, rtSelect_);
+    setIntegerParam(P_RtPending, 0);
+    setDoubleParam(P_RtTimeout, rtTimeout_);
+    publishRoundTrips();
+    setDoubleParam(P_RampTarget, 0.0);
+    ppt::rampInterlockMasks(rampMasks_);
+    setDoubleParam(P_RampRate, ramp_.config().rate);
+    setDoubleParam(P_RampStep, ramp_.config().step / 10.0);
+    setDoubleParam(P_RampTolerance, ramp_.config().tolerance / 10.0);
+    setDoubleParam(P_RampConfirmTimeout, ramp_.config().confirmTimeout);
+    setDoubleParam(P_RampStepBack, ramp_.config().stepBack / 10.0);
+    publishRamp();
+    commandEvent_ = epicsEventMustCreate(epicsEventEmpty);
+}
+
+bool pptDriver::startCommandTask()
+{
+    return epicsThreadCreate("pptCommand", epicsThreadPriorityHigh,
+                             epicsThreadGetStackSize(epicsThreadStackSmall),
+                             commandTaskC, this) != 0;
+}
+
+asynStatus pptDriver::writeCommandInt32(asynUser *pasynUser, epicsInt32 value)
+{
+    int function = pasynUser->reason;
+
+    if (function == P_CmdClearStats) {
+        clearCommandStats();
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_RampControl) {
+        double now = monotonicSeconds();
+
+        switch (value) {
+        case 0: ramp_.stop("operator"); break;
+        case 1:
+            if (!commandsLive || !ramp_.start(hvRaw_, rampTarget_, now))
+                return asynError;
+            break;
+        case 2: ramp_.pause("operator"); break;
+        case 3:
+            if (!ramp_.resume(now))
+                return asynError;
+            break;
+        default:
+            return asynError;
+        }
+        publishRamp();
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_RtSelect) {
+        if (value < 0 || value >= ppt::kNumCommands)
+            return asynError;
+        rtSelect_ = value;
+        setIntegerParam(P_RtSelect, value);
+        publishRoundTrips();
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_RtClear) {
+        for (int c = 0; c < ppt::kNumCommands; c++)
+            histograms_[c].clear();
+        rtDirty_ = true;
+        publishRoundTrips();
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    for (int c = 0; c < ppt::kNumCommands; c++)
+        if (function == P_Cmd[c])
+            return queueCommand(c, putSource());
+    return asynPortDriver::writeInt32(pasynUser, value);
+}
+
+asynStatus pptDriver::writeCommandFloat64(asynUser *pasynUser, epicsFloat64 value)
+{
+    int function = pasynUser->reason;
+
+    if (function == P_HVSet) {
+        if (!(value >= 0.0))
+            return asynError;
+        if (ramp_.active()) {
+            ramp_.stop("setpoint written");
+            publishRamp();
+        }
+        hvRaw_ = (uint16_t)std::min(floor(value * 10.0 + 0.5), (double)ppt::kHVMaxRaw);
+        setDoubleParam(P_HVSet, hvRaw_ / 10.0);
+        callParamCallbacks();
+        if (!commandsLive)
+            return asynSuccess;
+        return queueCommand(ppt::kSetHV, putSource());
+    }
+    if (function == P_RampTarget || function == P_RampStep || function == P_RampTolerance ||
+        function == P_RampStepBack) {
+        /* Setpoints in 0.1 kV, the wire resolution */
+        double raw = floor(value * 10.0 + 0.5);
+
+        if (!(raw >= 0.0) || raw > ppt::kHVMaxRaw || (function == P_RampStep && raw < 1.0))
+            return asynError;
+        if (function == P_RampTarget)
+            rampTarget_ = (uint16_t)raw;
+        else if (function == P_RampStep)
+            ramp_.config().step = (uint16_t)raw;
+        else if (function == P_RampTolerance)
+            ramp_.config().tolerance = (uint16_t)raw;
+        else
+            ramp_.config().stepBack = (uint16_t)raw;
+        setDoubleParam(function, raw / 10.0);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_RampRate || function == P_RampConfirmTimeout) {
+        if (!(value > 0.0))
+            return asynError;
+        if (function == P_RampRate)
+            ramp_.config().rate = value;
+        else
+            ramp_.config().confirmTimeout = value;
+        setDoubleParam(function, value);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_RtTimeout) {
+        if (!(value > 0.0))
+            return asynError;
+        rtTimeout_ = value;
+        setDoubleParam(P_RtTimeout, value);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_PulseHold) {
+        if (!(value >= 0.0))
+            return asynError;
+        pulseHold_ = value;
+        setDoubleParam(P_PulseHold, value);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_CoalesceWindow) {
+        if (!(value >= 0.0))
+            return asynError;
+        coalesceWindow_ = value;
+        setDoubleParam(P_CoalesceWindow, value);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_SafetyLimit) {
+        if (!(value > 0.0))
+            return asynError;
+        safetyLimit_ = value;
+        setDoubleParam(P_SafetyLimit, value);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    return asynPortDriver::writeFloat64(pasynUser, value);
+}
+
+void pptDriver::reportCommands(FILE *fp)
+{
+    fprintf(fp, "  command              count  latency ms     max ms  cancelled\n");
+    for (int k = 0; k < ppt::kNumCommandKinds; k++)
+        fprintf(fp, "  %-18s %7d %11.3f %10.3f %10d\n", ppt::commandKindName(k), cmdCount_[k],
+                cmdLatency_[k], cmdMaxLatency_[k], cmdCancelled_[k]);
+    fprintf(fp, "  queue wait ms: safety %.3f (max %.3f), normal %.3f (max %.3f); "
+            "OFF/Reset latency max %.3f ms, %d over %g ms\n", cmdWait_[ppt::kPrioritySafety],
+            cmdMaxWait_[ppt::kPrioritySafety], cmdWait_[ppt::kPriorityNormal],
+            cmdMaxWait_[ppt::kPriorityNormal], safetyLatency_, safetyOverruns_, safetyLimit_);
+    fprintf(fp, "  commands: %d sent, %d coalesced (window %g ms), %d errors, %lu queued, "
+            "setpoint %.1f kV\n", cmdSent_, coalesced_, coalesceWindow_, cmdErrors_,
+            (unsigned long)commands_.size(), hvRaw_ / 10.0);
+    fprintf(fp, "  pulses: hold %g ms, %d cleared\n", pulseHold_, pulses_);
+    if (journal_.isOpen())
+        fprintf(fp, "  journal: %s, %llu entries, ring of %llu, sources %s\n",
+                journal_.filename().c_str(), (unsigned long long)journal_.count(),
+                (unsigned long long)journal_.capacity(),
+                journalTrapped ? "Channel Access clients" : "local only (no TRAPWRITE rule)");
+}
+
+/* Called with the lock held */
+asynStatus pptDriver::queueCommand(int command, int source)
+{
+    const char *functionName = "queueCommand";
+    std::vector<ppt::QueuedCommand> cancelled;
+
+    if (command == ppt::HVPSOff || command == ppt::ChargePFNOff) {
+        ramp_.stop("HVPS or Charge PFN OFF");
+        publishRamp();
+    }
+
+    if (!commands_.push(command, monotonicSeconds(), source, cancelled)) {
+        asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: %s: queue full, %s dropped\n",
+                  driverName, functionName, portName, ppt::commandKindName(command));
+        cmdErrors_++;
+        setIntegerParam(P_CmdErrors, cmdErrors_);
+        callParamCallbacks();
+        return asynError;
+    }
+    countCancelled(cancelled, command);
+    setIntegerParam(P_CmdQueued, (epicsInt32)commands_.size());
+    callParamCallbacks();
+    epicsEventSignal(commandEvent_);
+    return asynSuccess;
+}
+
+/* Called with the lock held: entries cancelled by command */
+void pptDriver::countCancelled(const std::vector<ppt::QueuedCommand> &cancelled, int command)
+{
+    const char *functionName = "countCancelled";
+
+    for (size_t i = 0; i < cancelled.size(); i++) {
+        asynPrint(pasynUserSelf, ASYN_TRACE_FLOW, "%s:%s: %s: %s cancelled by %s\n",
+                  driverName, functionName, portName,
+                  ppt::commandKindName(cancelled[i].command), ppt::commandKindName(command));
+        cmdCancelled_[cancelled[i].command]++;
+    }
+    if (!cancelled.empty())
+        doCallbacksInt32Array(cmdCancelled_, ppt::kNumCommandKinds, P_CmdCancelled, 0);
+}
+
+/*
+ * Called with the lock held from a write of a command parameter: the
+ * journal source of the put, the Channel Access client if there is one
+ */
+int pptDriver::putSource()
+{
+    asTrapWriteMessage *pmessage;
+    char client[128];
+
+    if (!journal_.isOpen() || !journalClient)
+        return ppt::kSourceLocal;
+    pmessage = (asTrapWriteMessage *)epicsThreadPrivateGet(journalClient);
+    if (!pmessage)
+        return ppt::kSourceLocal;
+    snprintf(client, sizeof(client), "%s@%s", pmessage->userid, pmessage->hostid);
+    if (strcmp(client, journalIocClient) == 0)
+        return ppt::kSourceIoc;
+    return journal_.source(client);
+}
+
+/* Called with the lock held: round trip of command ended with outcome */
+void pptDriver::journalResult(int command, int outcome, double now)
+{
+    ppt::JournalEntry entry;
+
+    if (!journal_.isOpen())
+        return;
+    memset(&entry, 0, sizeof(entry));
+    entry.time = journalTime(now);
+    entry.image = roundTrip_[command].image;
+    entry.latency = (uint32_t)((now - roundTrip_[command].sent) * 1e6);
+    entry.kind = ppt::kJournalResult;
+    entry.command = command;
+    entry.outcome = outcome;
+    journal_.append(entry);
+}
+
+/* Called with the lock held */
+void pptDriver::clearCommandStats()
+{
+    for (int k = 0; k < ppt::kNumCommandKinds; k++) {
+        cmdCount_[k] = 0;
+        cmdLatency_[k] = 0.0;
+        cmdMaxLatency_[k] = 0.0;
+        cmdCancelled_[k] = 0;
+    }
+    for (int p = 0; p < ppt::kNumPriorities; p++) {
+        cmdWait_[p] = 0.0;
+        cmdMaxWait_[p] = 0.0;
+    }
+    cmdSent_ = 0;
+    cmdErrors_ = 0;
+    coalesced_ = 0;
+    pulses_ = 0;
+    safetyLatency_ = 0.0;
+    safetyOverruns_ = 0;
+    publishCommands();
+}
+
+void pptDriver::publishCommands()
+{
+    setIntegerParam(P_CmdSent, cmdSent_);
+    setIntegerParam(P_CmdErrors, cmdErrors_);
+    setIntegerParam(P_Coalesced, coalesced_);
+    setIntegerParam(P_Pulses, pulses_);
+    setIntegerParam(P_CmdQueued, (epicsInt32)commands_.size());
+    doCallbacksInt32Array(cmdCount_, ppt::kNumCommandKinds, P_CmdCount, 0);
+    doCallbacksFloat64Array(cmdLatency_, ppt::kNumCommandKinds, P_CmdLatency, 0);
+    doCallbacksFloat64Array(cmdMaxLatency_, ppt::kNumCommandKinds, P_CmdMaxLatency, 0);
+    doCallbacksInt32Array(cmdCancelled_, ppt::kNumCommandKinds, P_CmdCancelled, 0);
+    doCallbacksFloat64Array(cmdWait_, ppt::kNumPriorities, P_CmdWait, 0);
+    doCallbacksFloat64Array(cmdMaxWait_, ppt::kNumPriorities, P_CmdMaxWait, 0);
+    setDoubleParam(P_SafetyLatency, safetyLatency_);
+    setIntegerParam(P_SafetyOverruns, safetyOverruns_);
+}
+
+/* Writer of the command register: one image per queued command */
+void pptDriver::commandTask()
+{
+    const char *functionName = "commandTask";
+    uint16_t pulseBits = 0;         /* edge bits of the last image, still set */
+    uint16_t levelBits = 0;         /* its OFF bits, kept by the pulse end */
+    double pulseEnd = 0.0;
+
+    for (;;) {
+        std::vector<ppt::QueuedCommand> batch;
+        ppt::QueuedCommand entry;
+        uint16_t bits;
+        uint32_t image;
+        bool safety, written;
+        uint32_t number = 0;
+        double now;
+        std::string names;
+
+        lock();
+        /* End the pulse: the image without its edge bits after the hold */
+        while (pulseBits) {
+            int head = commands_.headCommand();
+            double left = pulseEnd - monotonicSeconds();
+
+            if (head >= 0 && ppt::commandPriority(head) == ppt::kPrioritySafety &&
+                !(ppt::commandBits(head) & pulseBits))
+                break;
+            if (left > 0.0) {
+                unlock();
+                epicsEventWaitWithTimeout(commandEvent_, left);
+                lock();
+                continue;
+            }
+            image = ppt::commandImage(levelBits, hvRaw_);
+            unlock();
+            written = writeImage(image);
+            now = monotonicSeconds();
+            lock();
+            journalClear(image, written, now);
+            /* Not written: the connection is down, the next image replaces it */
+            if (!written)
+                asynPrint(pasynUserSelf, ASYN_TRACE_ERROR,
+                          "%s:%s: %s: pulse end not written: %s\n", driverName, functionName,
+                          portName, pasynUserCmd_->errorMessage);
+            else
+                pulses_++;
+            publishImage(image, written);
+            publishCommands();
+            callParamCallbacks();
+            break;
+        }
+        pulseBits = 0;
+        while (!commands_.pop(entry)) {
+            unlock();
+            epicsEventMustWait(commandEvent_);
+            lock();
+        }
+        batch.push_back(entry);
+        bits = ppt::commandBits(entry.command);
+        safety = ppt::commandPriority(entry.command) == ppt::kPrioritySafety;
+        if (coalesceWindow_ > 0.0) {
+            double deadline = entry.queued + coalesceWindow_ * 1e-3;
+
+            for (;;) {
+                double left;
+
+                for (;;) {
+                    std::vector<ppt::QueuedCommand> cancelled;
+                    int head = commands_.headCommand();
+
+                    /* A safety entry also cancels the entries of this image it supersedes */
+                    if (head >= 0 && ppt::commandPriority(head) == ppt::kPrioritySafety) {
+                        bits = ppt::supersedeBatch(head, batch, cancelled);
+                        countCancelled(cancelled, head);
+                    }
+                    if (!commands_.popCompatible(bits, entry))
+                        break;
+                    batch.push_back(entry);
+                    bits |= ppt::commandBits(entry.command);
+                    safety |= ppt::commandPriority(entry.command) == ppt::kPrioritySafety;
+                }
+                left = deadline - monotonicSeconds();
+                if (left <= 0.0 || safety || !commands_.empty())
+                    break;
+                unlock();
+                epicsEventWaitWithTimeout(commandEvent_, left);
+                lock();
+            }
+        }
+        /* The setpoint of now: a change queued after entry is not lost */
+        image = ppt::commandImage(bits, hvRaw_);
+        now = monotonicSeconds();
+        for (size_t i = 0; i < batch.size(); i++) {
+            int priority = ppt::commandPriority(batch[i].command);
+            double wait = (now - batch[i].queued) * 1e3;
+
+            cmdWait_[priority] = wait;
+            cmdMaxWait_[priority] = std::max(cmdMaxWait_[priority], wait);
+            names += std::string(i ? " " : "") + ppt::commandKindName(batch[i].command);
+        }
+        setIntegerParam(P_CmdQueued, (epicsInt32)commands_.size());
+        unlock();
+
+        written = writeImage(image);
+        now = monotonicSeconds();
+
+        lock();
+        if (journal_.isOpen()) {
+            ppt::JournalEntry record;
+
+            memset(&record, 0, sizeof(record));
+            number = journal_.nextImage();
+            for (size_t i = 0; i < batch.size(); i++) {
+                record.time = journalTime(batch[i].queued);
+                record.image = number;
+                record.value = image;
+                record.latency = (uint32_t)((now - batch[i].queued) * 1e6);
+                record.kind = ppt::kJournalWrite;
+                record.command = batch[i].command;
+                record.source = batch[i].source;
+                record.outcome = written ? ppt::kOutcomeWritten : ppt::kOutcomeWriteError;
+                journal_.append(record);
+            }
+        }
+        if (!written) {
+            asynPrint(pasynUserSelf, ASYN_TRACE_ERROR, "%s:%s: %s: %s not written: %s\n",
+                      driverName, functionName, portName, names.c_str(),
+                      pasynUserCmd_->errorMessage);
+        } else {
+            cmdSent_++;
+            if (batch.size() > 1)
+                coalesced_++;
+            for (size_t i = 0; i < batch.size(); i++) {
+                int command = batch[i].command;
+                double latency = (now - batch[i].queued) * 1e3;
+
+                cmdCount_[command]++;
+                cmdLatency_[command] = latency;
+                cmdMaxLatency_[command] = std::max(cmdMaxLatency_[command], latency);
+                if (ppt::commandPriority(command) == ppt::kPrioritySafety) {
+                    safetyLatency_ = std::max(safetyLatency_, latency);
+                    if (latency > safetyLimit_)
+                        safetyOverruns_++;
+                }
+                startRoundTrip(command, now, number);
+            }
+            if ((bits & ppt::kEdgeBits) && pulseHold_ > 0.0) {
+                pulseBits = bits & ppt::kEdgeBits;
+                levelBits = bits & ~ppt::kEdgeBits;
+                pulseEnd = now + pulseHold_ * 1e-3;
+            }
+        }
+        publishImage(image, written);
+        publishCommands();
+        callParamCallbacks();
+        unlock();
+    }
+}
+
+/* Write image in the writeFullCmd32 format; called without the lock */
+bool pptDriver::writeImage(uint32_t image)
+{
+    uint8_t out[ppt::kCmd32Bytes];
+    size_t nWritten = 0;
+    asynStatus status;
+
+    ppt::encodeCommand32(image, out);
+    status = pasynOctetSyncIO->write(pasynUserCmd_, (const char *)out, sizeof(out),
+                                     kWriteTimeout, &nWritten);
+    return status == asynSuccess && nWritten == sizeof(out);
+}
+
+/* Called with the lock held: CmdReg32 after a write of image */
+void pptDriver::publishImage(uint32_t image, bool written)
+{
+    if (!written) {
+        cmdErrors_++;
+        setParamStatus(P_CmdReg32, asynError);
+        setParamAlarmStatus(P_CmdReg32, WRITE_ALARM);
+        setParamAlarmSeverity(P_CmdReg32, INVALID_ALARM);
+        return;
+    }
+    setIntegerParam(P_CmdReg32, (epicsInt32)image);
+    setParamStatus(P_CmdReg32, asynSuccess);
+    setParamAlarmStatus(P_CmdReg32, NO_ALARM);
+    setParamAlarmSeverity(P_CmdReg32, NO_ALARM);
+}
+
+/* Called with the lock held: journal the image ending a pulse */
+void pptDriver::journalClear(uint32_t image, bool written, double now)
+{
+    ppt::JournalEntry record;
+
+    if (!journal_.isOpen())
+        return;
+    memset(&record, 0, sizeof(record));
+    record.time = journalTime(now);
+    record.image = journal_.nextImage();
+    record.value = image;
+    record.kind = ppt::kJournalClear;
+    record.outcome = written ? ppt::kOutcomeWritten : ppt::kOutcomeWriteError;
+    journal_.append(record);
+}
+
+/* Called with the lock held: one ramp step per frame at most */
+void pptDriver::updateRamp(const ppt::FrameView &view, const uint8_t *quality, double now)
+{
+    const int voltage = ppt::field::HVPSChargingVoltage::word;
+    bool tripped = false;
+    uint16_t setpoint;
+
+    if (ramp_.state() != ppt::kRampRunning)
+        return;
+    for (int w = 0; w < ppt::kFrameWords; w++)
+        if (rampMasks_[w])
+            tripped |= quality[w] || (view.word(w) & rampMasks_[w]) != 0;
+    if (ramp_.update(quality[voltage] ? -1 : view.word(voltage), tripped, now, setpoint)) {
+        hvRaw_ = setpoint;
+        setDoubleParam(P_HVSet, setpoint / 10.0);
+        if (queueCommand(ppt::kSetHV, ppt::kSourceRamp) != asynSuccess)
+            ramp_.pause("command queue full");
+    }
+    publishRamp();
+}
+
+/* Called with the lock held */
+void pptDriver::publishRamp()
+{
+    setIntegerParam(P_RampState, ramp_.state());
+    setStringParam(P_RampReason, ramp_.reason());
+    setDoubleParam(P_RampProgress, ramp_.progress());
+    setDoubleParam(P_RampEta, ramp_.eta());
+}
+
+/* Called with the lock held, after command was written */
+void pptDriver::startRoundTrip(int command, double sent, uint32_t image)
+{
+    uint32_t superseded = ppt::supersededBy(command);
+
+    if (command >= ppt::kNumCommands)
+        return;
+    for (int c = 0; c < ppt::kNumCommands; c++) {
+        if ((superseded & (1u << c)) && roundTrip_[c].pending) {
+            journalResult(c, ppt::kOutcomeSuperseded, sent);
+            roundTrip_[c].pending = false;
+        }
+    }
+    /* A repeated command restarts its round trip */
+    if (roundTrip_[command].pending)
+        journalResult(command, ppt::kOutcomeSuperseded, sent);
+    roundTrip_[command].pending = roundTrip_[command].known;
+    roundTrip_[command].sent = sent;
+    roundTrip_[command].image = image;
+}
+
+/*
+ * Called with the lock held: complete the round trips the frame (view,
+ * may be NULL) shows and time out the ones older than RoundTrip:Timeout
+ */
+void pptDriver::checkRoundTrips(const ppt::FrameView *view, const uint8_t *quality, double now)
+{
+    bool changed = false;
+    int pending = 0;
+
+    for (int c = 0; c < ppt::kNumCommands; c++) {
+        RoundTrip &rt = roundTrip_[c];
+        const ppt::CommandEffect &effect = rt.effect;
+
+        if (!rt.pending)
+            continue;
+        if (view && !quality[effect.word]) {
+            uint16_t bits = view->word(effect.word) & effect.mask;
+            if (effect.state ? bits != 0 : bits == 0) {
+                histograms_[c].add((now - rt.sent) * 1e3);
+                journalResult(c, ppt::kOutcomeConfirmed, now);
+                rt.pending = false;
+                changed = true;
+                continue;
+            }
+        }
+        if (now - rt.sent > rtTimeout_) {
+            histograms_[c].addTimeout();
+            journalResult(c, ppt::kOutcomeTimeout, now);
+            rt.pending = false;
+            changed = true;
+            continue;
+        }
+        pending++;
+    }
+    setIntegerParam(P_RtPending, pending);
+    if (changed) {
+        rtDirty_ = true;
+        publishRoundTrips();
+        callParamCallbacks();
+    }
+}
+
+/* Called with the lock held */
+void pptDriver::publishRoundTrips()
+{
+    epicsInt32 count[ppt::kNumCommandKinds], timeouts[ppt::kNumCommandKinds];
+    epicsFloat64 minimum[ppt::kNumCommandKinds], median[ppt::kNumCommandKinds];
+    epicsFloat64 p99[ppt::kNumCommandKinds], maximum[ppt::kNumCommandKinds];
+    epicsInt32 histogram[ppt::LatencyHistogram::kBuckets];
+    epicsFloat64 limits[ppt::LatencyHistogram::kBuckets];
+    const ppt::LatencyHistogram &selected = histograms_[rtSelect_];
+
+    for (int k = 0; k < ppt::kNumCommandKinds; k++) {
+        const ppt::LatencyHistogram *h = k < ppt::kNumCommands ? &histograms_[k] : NULL;
+
+        count[k] = h ? (epicsInt32)h->count() : 0;
+        timeouts[k] = h ? (epicsInt32)h->timeouts() : 0;
+        minimum[k] = h ? h->min() : 0.0;
+        median[k] = h ? h->quantile(0.5) : 0.0;
+        p99[k] = h ? h->quantile(0.99) : 0.0;
+        maximum[k] = h ? h->max() : 0.0;
+    }
+    for (int i = 0; i < ppt::LatencyHistogram::kBuckets; i++) {
+        histogram[i] = (epicsInt32)selected.buckets()[i];
+        limits[i] = ppt::LatencyHistogram::bucketLimit(i);
+    }
+    doCallbacksInt32Array(count, ppt::kNumCommandKinds, P_RtCount, 0);
+    doCallbacksInt32Array(timeouts, ppt::kNumCommandKinds, P_RtTimeouts, 0);
+    doCallbacksFloat64Array(minimum, ppt::kNumCommandKinds, P_RtMin, 0);
+    doCallbacksFloat64Array(median, ppt::kNumCommandKinds, P_RtMedian, 0);
+    doCallbacksFloat64Array(p99, ppt::kNumCommandKinds, P_RtP99, 0);
+    doCallbacksFloat64Array(maximum, ppt::kNumCommandKinds, P_RtMax, 0);
+    doCallbacksInt32Array(histogram, ppt::LatencyHistogram::kBuckets, P_RtHistogram, 0);
+    doCallbacksFloat64Array(limits, ppt::LatencyHistogram::kBuckets, P_RtBuckets, 0);
+}
+
+/* Write the histograms to the file if they changed; false if that failed */
+bool pptDriver::saveRoundTrips()
+{
+    std::string filename, text;
+    bool saved;
+    FILE *fp;
+
+    lock();
+    if (rtDirty_ && !rtFile_.empty()) {
+        filename = rtFile_;
+        for (int c = 0; c < ppt::kNumCommands; c++)
+            text += std::string(ppt::commandMap[c].name) + " " + histograms_[c].format() + "\n";
+    }
+    rtDirty_ = false;
+    unlock();
+    if (filename.empty())
+        return true;
+
+    /* Replace the file only once the new one is complete */
+    std::string tmp = filename + ".tmp";
+    saved = (fp = fopen(tmp.c_str(), "w")) != NULL;
+    if (fp) {
+        saved = fputs(text.c_str(), fp) >= 0;
+        saved = fclose(fp) == 0 && saved;
+    }
+    saved = saved && rename(tmp.c_str(), filename.c_str()) == 0;
+    if (!saved) {
+        /* Keep them for the next attempt */
+        lock();
+        rtDirty_ = true;
+        unlock();
+    }
+    return saved;
+}
+
+/* Persist the histograms off the frame and command threads */
+void pptDriver::roundTripTask()
+{
+    const char *functionName = "roundTripTask";
+    bool failed = false;
+
+    for (;;) {
+        epicsThreadSleep(kRoundTripSave);
+        if (saveRoundTrips()) {
+            failed = false;
+        } else if (!failed) {
+            /* Once per run of failures, the file is retried every period */
+            lock();
+            std::string filename = rtFile_;
+            unlock();
+            printf("%s:%s: %s: cannot write %s\n", driverName, functionName, portName,
+                   filename.c_str());
+            failed = true;
+        }
+    }
+}
+
+/* Load the histograms from filename and keep them there; returns the number loaded */
+int pptDriver::setRoundTripFile(const char *filename)
+{
+    const char *functionName = "setRoundTripFile";
+    char line[1024];
+    int loaded = 0;
+    bool first;
+    FILE *fp = fopen(filename, "r");
+
+    lock();
+    first = rtFile_.empty();
+    rtFile_ = filename;
+    while (fp && fgets(line, sizeof(line), fp)) {
+        char name[64];
+        int n;
+
+        if (sscanf(line, " %63s%n", name, &n) != 1 || name[0] == '#')
+            continue;
+        for (int c = 0; c < ppt::kNumCommands; c++) {
+            if (strcmp(ppt::commandMap[c].name, name) != 0)
+                continue;
+            if (histograms_[c].parse(line + n))
+                loaded++;
+            else
+                printf("pptRoundTripFile: %s: bad line for %s\n", filename, name);
+        }
+    }
+    if (fp)
+        fclose(fp);
+    publishRoundTrips();
+    callParamCallbacks();
+    unlock();
+    if (first && !epicsThreadCreate("pptRoundTrip", epicsThreadPriorityLow,
+                                    epicsThreadGetStackSize(epicsThreadStackSmall),
+                                    roundTripTaskC, this))
+        printf("%s:%s: epicsThreadCreate failed\n", driverName, functionName);
+    return loaded;
+}
+
+/* Map the command journal and start recording the put sources */
+bool pptDriver::setJournalFile(const char *filename, size_t capacity)
+{
+    std::string error;
+    bool opened;
+
+    if (!journalClient) {
+        char user[64], host[64];
+
+        if (osiGetUserName(user, sizeof(user)) != osiGetUserNameSuccess)
+            strcpy(user, "?");
+        if (gethostname(host, sizeof(host)) != 0)
+            strcpy(host, "?");
+        host[sizeof(host) - 1] = '\0';
+        snprintf(journalIocClient, sizeof(journalIocClient), "%s@%s", user, host);
+        journalClient = epicsThreadPrivateCreate();
+        asTrapWriteRegisterListener(journalTrapWrite);
+    }
+    lock();
+    opened = journal_.open(filename, capacity, true, error);
+    unlock();
+    if (!opened)
+        printf("pptCommandJournal: %s: %s\n", filename, error.c_str());
+    return opened;
+}
+
+/* Whether a rule of the access security configuration has TRAPWRITE */
+static bool trapWriteRules()
+{
+    ASG *pasg;
+    ASGRULE *prule;
+
+    if (!asActive || !pasbase)
+        return false;
+    for (pasg = (ASG *)ellFirst((ELLLIST *)&pasbase->asgList); pasg;
+         pasg = (ASG *)ellNext(&pasg->node))
+        for (prule = (ASGRULE *)ellFirst(&pasg->ruleList); prule;
+             prule = (ASGRULE *)ellNext(&prule->node))
+            if (prule->trapMask)
+                return true;
+    return false;
+}
+
+void pptCommandInitHook(initHookState state)
+{
+    if (state != initHookAfterInitialProcess)
+        return;
+    commandsLive = true;
+    /* Access security is loaded by now; without TRAPWRITE puts are local */
+    journalTrapped = journalClient && trapWriteRules();
+    if (journalClient && !journalTrapped)
+        printf("pptCommandJournal: no TRAPWRITE rule in access security, Channel Access "
+               "puts are journaled as local; see ppt.acf\n");
+}
@@ -0,0 +1,284 @@
+/*
+ * pptDriverHistory.cpp
+ *
+ * pptDriver (pptDriver.h): what happened between two looks at a display.
+ *
+ * Interlock latch (pptInterlocks.h): every frame updates the latched and
+ * held interlock words, so a bit set for a single frame is never lost.
+ * Latch:Ack clears the latched bits that are no longer set, Latch:HoldTime
+ * is the minimum hold time in seconds.
+ *
+ * Sequence of events (pptSoe.h): every edge of a status/interlock bit is
+ * recorded with the receive time of its frame and the first faults of a
+ * trip are marked. The Soe:* arrays hold the last kSoeDepth edges, oldest
+ * first, and are posted when a frame brings new edges; pptSoeDump prints
+ * them with bit names.
+ *
+ * Trends: every analog channel has a ring of trendDepth samples,
+ * allocated once at configuration. A sample is the mean of the channel's
+ * valid values over Trend:Period seconds (NaN if there was none, one NaN
+ * marks a gap without frames). The arrays are posted oldest first after
+ * each sample, or only the new samples with Trend:DeltaOnly.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#include <epicsTime.h>
+#include <asynPortDriver.h>
+
+#include "pptDriver.h"
+
+/* Latch, SOE and trend parameters */
+void pptDriver::createHistory(int trendDepth)
+{
+    for (int i = 0; i < ppt::kNumInterlockWords; i++) {
+        std::string sub = ppt::interlockSubsystems[i];
+        createParam((sub + ":InterlockLatched").c_str(), asynParamInt32, &P_Latched[i]);
+        createParam((sub + ":InterlockHeld").c_str(), asynParamInt32, &P_Held[i]);
+    }
+    createParam("Latch:Any", asynParamInt32, &P_LatchAny);
+    createParam("Latch:HoldTime", asynParamFloat64, &P_HoldTime);
+    createParam("Latch:Ack", asynParamInt32, &P_LatchAck);
+    createParam("Soe:Time", asynParamFloat64Array, &P_SoeTime);
+    createParam("Soe:Bit", asynParamInt32Array, &P_SoeBit);
+    createParam("Soe:Edge", asynParamInt32Array, &P_SoeEdge);
+    createParam("Soe:Trip", asynParamInt32Array, &P_SoeTrip);
+    createParam("Soe:FirstFault", asynParamInt32Array, &P_SoeFirstFault);
+    createParam("Soe:Count", asynParamInt32, &P_SoeCount);
+    createParam("Soe:Trips", asynParamInt32, &P_SoeTrips);
+    createParam("Soe:Tripped", asynParamInt32, &P_SoeTripped);
+    createParam("Soe:FirstFaults", asynParamOctet, &P_SoeFirstFaults);
+    createParam("Soe:Clear", asynParamInt32, &P_SoeClear);
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        const ppt::ChannelInfo &info = ppt::channelMap[c];
+
+        trendOf_[c] = -1;
+        trendSum_[c] = 0.0;
+        trendValues_[c] = 0;
+        if (info.kind != ppt::kAnalog)
+            continue;
+        trendOf_[c] = (int)trends_.size();
+        trends_.push_back(ppt::TrendBuffer(trendDepth));
+        createParam((std::string(info.name) + ":Trend").c_str(), asynParamFloat64Array,
+                    &P_Trend[c]);
+    }
+    createParam("Trend:Time", asynParamFloat64Array, &P_TrendTime);
+    createParam("Trend:Period", asynParamFloat64, &P_TrendPeriod);
+    createParam("Trend:DeltaOnly", asynParamInt32, &P_TrendDeltaOnly);
+    createParam("Trend:Depth", asynParamInt32, &P_TrendDepth);
+    createParam("Trend:Count", asynParamInt32, &P_TrendCount);
+    createParam("Trend:Bytes", asynParamInt32, &P_TrendBytes);
+
+    setDoubleParam(P_HoldTime, latch_.holdTime());
+    publishLatch();
+    setIntegerParam(P_SoeCount, 0);
+    setIntegerParam(P_SoeTrips, 0);
+    setIntegerParam(P_SoeTripped, 0);
+    setStringParam(P_SoeFirstFaults, "");
+    trendStart_ = 0.0;
+    trendPeriod_ = 1.0;
+    trendDeltaOnly_ = false;
+    setDoubleParam(P_TrendPeriod, trendPeriod_);
+    setIntegerParam(P_TrendDeltaOnly, 0);
+    setIntegerParam(P_TrendDepth, (epicsInt32)trendTime_.depth());
+    setIntegerParam(P_TrendCount, 0);
+    setIntegerParam(P_TrendBytes, (epicsInt32)trendTime_.bytes());
+}
+
+asynStatus pptDriver::writeHistoryInt32(asynUser *pasynUser, epicsInt32 value)
+{
+    int function = pasynUser->reason;
+
+    if (function == P_LatchAck) {
+        latch_.acknowledge();
+        publishLatch();
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_SoeClear) {
+        soe_.clear();
+        publishSoe();
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_TrendDeltaOnly) {
+        trendDeltaOnly_ = value != 0;
+        setIntegerParam(P_TrendDeltaOnly, trendDeltaOnly_);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    return asynPortDriver::writeInt32(pasynUser, value);
+}
+
+asynStatus pptDriver::writeHistoryFloat64(asynUser *pasynUser, epicsFloat64 value)
+{
+    int function = pasynUser->reason;
+
+    if (function == P_HoldTime) {
+        if (!(value >= 0.0))
+            return asynError;
+        latch_.setHoldTime(value);
+        setDoubleParam(P_HoldTime, value);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    if (function == P_TrendPeriod) {
+        if (!(value > 0.0))
+            return asynError;
+        /* Samples of different periods do not share one time axis */
+        trendPeriod_ = value;
+        trendStart_ = 0.0;
+        trendTime_.clear();
+        for (size_t t = 0; t < trends_.size(); t++)
+            trends_[t].clear();
+        for (int c = 0; c < ppt::kNumChannels; c++) {
+            trendSum_[c] = 0.0;
+            trendValues_[c] = 0;
+        }
+        setDoubleParam(P_TrendPeriod, value);
+        publishTrends(0);
+        callParamCallbacks();
+        return asynSuccess;
+    }
+    return asynPortDriver::writeFloat64(pasynUser, value);
+}
+
+void pptDriver::reportHistory(FILE *fp)
+{
+    fprintf(fp, "  trends: %lu channels x %lu samples of %g s, %lu bytes per channel, "
+            "%lu bytes with the time axis\n", (unsigned long)trends_.size(),
+            (unsigned long)trendTime_.depth(), trendPeriod_, (unsigned long)trendTime_.bytes(),
+            (unsigned long)((trends_.size() + 1) * trendTime_.bytes()));
+}
+
+/* Sample the trends when the period ends with the frame received at time */
+void pptDriver::closeTrendPeriod(double time)
+{
+    size_t newSamples = 0;
+    double end;
+
+    if (trendStart_ == 0.0)
+        trendStart_ = time;
+    end = trendStart_ + trendPeriod_;
+    if (time < end)
+        return;
+    pushTrendSample(end, false);
+    newSamples++;
+    if (time - end >= trendPeriod_) {
+        pushTrendSample(end + trendPeriod_, true);
+        newSamples++;
+        trendStart_ = time;
+    } else {
+        trendStart_ = end;
+    }
+    publishTrends(newSamples);
+}
+
+/* Close the period: the mean of each channel, or NaN for a gap */
+void pptDriver::pushTrendSample(double time, bool gap)
+{
+    trendTime_.push(time);
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        if (trendOf_[c] < 0)
+            continue;
+        trends_[trendOf_[c]].push((gap || !trendValues_[c]) ? NAN
+                                  : trendSum_[c] / trendValues_[c]);
+        trendSum_[c] = 0.0;
+        trendValues_[c] = 0;
+    }
+}
+
+/*
+ * Post the trend arrays: all samples, or the newSamples newest with
+ * Trend:DeltaOnly (none after a clear, which posts the empty arrays)
+ */
+void pptDriver::publishTrends(size_t newSamples)
+{
+    bool delta = trendDeltaOnly_ && newSamples;
+    size_t count = delta ? std::min(newSamples, trendTime_.size()) : trendTime_.size();
+    const double *times = delta ? trendTime_.latest(count) : trendTime_.data();
+
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        const ppt::TrendBuffer *trend;
+
+        if (trendOf_[c] < 0)
+            continue;
+        trend = &trends_[trendOf_[c]];
+        doCallbacksFloat64Array((epicsFloat64 *)(delta ? trend->latest(count) : trend->data()),
+                                count, P_Trend[c], 0);
+    }
+    doCallbacksFloat64Array((epicsFloat64 *)times, count, P_TrendTime, 0);
+    setIntegerParam(P_TrendCount, (epicsInt32)trendTime_.size());
+}
+
+/* Latched and held interlock words */
+void pptDriver::publishLatch()
+{
+    bool any = false;
+
+    for (int i = 0; i < ppt::kNumInterlockWords; i++) {
+        setIntegerParam(P_Latched[i], latch_.latched(i));
+        setIntegerParam(P_Held[i], latch_.held(i));
+        any |= latch_.latched(i) != 0;
+    }
+    setIntegerParam(P_LatchAny, any);
+}
+
+/* SOE arrays, oldest edge first, and the trip state */
+void pptDriver::publishSoe()
+{
+    size_t count = soe_.size();
+    std::string firstFaults;
+
+    for (size_t i = 0; i < count; i++) {
+        const ppt::SoeEvent &event = soe_.at(i);
+        soeTime_[i] = event.time;
+        soeBit_[i] = event.bit;
+        soeEdge_[i] = event.rising;
+        soeTrip_[i] = (epicsInt32)event.trip;
+        soeFirstFault_[i] = event.firstFault;
+    }
+    for (int i = 0; i < soe_.numFirstFaults(); i++) {
+        if (i)
+            firstFaults += " ";
+        firstFaults += ppt::bitMap[soe_.firstFault(i)].name;
+    }
+
+    doCallbacksFloat64Array(soeTime_, count, P_SoeTime, 0);
+    doCallbacksInt32Array(soeBit_, count, P_SoeBit, 0);
+    doCallbacksInt32Array(soeEdge_, count, P_SoeEdge, 0);
+    doCallbacksInt32Array(soeFirstFault_, count, P_SoeFirstFault, 0);
+    doCallbacksInt32Array(soeTrip_, count, P_SoeTrip, 0);
+    setIntegerParam(P_SoeCount, (epicsInt32)count);
+    setIntegerParam(P_SoeTrips, (epicsInt32)soe_.trips());
+    setIntegerParam(P_SoeTripped, soe_.tripped());
+    setStringParam(P_SoeFirstFaults, firstFaults.c_str());
+}
+
+/* Print the last count SOE edges (all if count <= 0) */
+void pptDriver::dumpSoe(int count)
+{
+    lock();
+    size_t n = soe_.size();
+    size_t first = (count > 0 && (size_t)count < n) ? n - count : 0;
+
+    printf("%s: %lu edges recorded, %lu in the log, %u trips%s\n", portName,
+           soe_.total(), (unsigned long)n, soe_.trips(), soe_.tripped() ? ", tripped" : "");
+    for (size_t i = first; i < n; i++) {
+        const ppt::SoeEvent &event = soe_.at(i);
+        epicsTimeStamp ts;
+        char when[40];
+
+        epicsTimeFromTime_t(&ts, (time_t)event.time);
+        ts.nsec = (epicsUInt32)((event.time - floor(event.time)) * 1e9);
+        epicsTimeToStrftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S.%06f", &ts);
+        printf("  %s  frame %-8u trip %-4u %s %-40s%s\n", when, event.frame, event.trip,
+               event.rising ? "set  " : "clear", ppt::bitMap[event.bit].name,
+               event.firstFault ? "  FIRST FAULT" : "");
+    }
+    unlock();
+}
@@ -0,0 +1,393 @@
+/*
+ * pptFrameRecord.cpp
+ *
+ * Record support for the pptFrame record (see pptFrameRecord.dbd)
+ *
+ * Device support fills RAW/NRAW with one 86-byte frame. The record then
+ * validates it against the register map, tracks per-word changes and,
+ * unless more than MAXF checks failed, decodes all 39 channels into the
+ * THV..GST fields. Only fields whose value changed post monitors, so the
+ * compatibility records linked to them (ppt_frame.template) process only
+ * when their channel moves. A rejected frame sets READ/INVALID and leaves
+ * the channels untouched. SNAP repeats the frame as one DOUBLE array.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#define USE_TYPED_RSET
+#define USE_TYPED_DSET
+
+#include <alarm.h>
+#include <dbAccess.h>
+#include <dbEvent.h>
+#include <dbFldTypes.h>
+#include <devSup.h>
+#include <errMdef.h>
+#include <recSup.h>
+#include <recGbl.h>
+#include <epicsTime.h>
+#include <epicsTypes.h>
+
+#define GEN_SIZE_OFFSET
+#include "pptFrameRecord.h"
+#undef  GEN_SIZE_OFFSET
+#include <epicsExport.h>
+
+#include "pptFrameView.h"
+#include "pptProto.h"
+
+static_assert(pptFrameRecordGST - pptFrameRecordTHV == ppt::kNumChannels - 1,
+              "pptFrame channel fields do not match ppt::channelMap");
+
+/* SNAP layout, see pptFrameRecord.dbd */
+enum {
+    kSnapTime,
+    kSnapFrames,
+    kSnapFailed,
+    kSnapRejected,
+    kSnapChannels,
+    kSnapQuality = kSnapChannels + ppt::kNumChannels,
+    kSnapSize = kSnapQuality + ppt::kFrameWords
+};
+static_assert(sizeof(((pptFrameRecord *)0)->snap) == kSnapSize * sizeof(double),
+              "pptFrame SNAP size does not match its layout");
+
+/* Device support entry table */
+typedef struct pptFramedset {
+    dset common;
+    long (*read_frame)(pptFrameRecord *prec);
+} pptFramedset;
+
+static long init_record(dbCommon *pcommon, int pass);
+static long process(dbCommon *pcommon);
+static long cvt_dbaddr(DBADDR *paddr);
+static long get_array_info(DBADDR *paddr, long *no_elements, long *offset);
+static long put_array_info(DBADDR *paddr, long nNew);
+static long get_units(DBADDR *paddr, char *units);
+static long get_precision(const DBADDR *paddr, long *precision);
+static long get_graphic_double(DBADDR *paddr, struct dbr_grDouble *pgd);
+static long get_control_double(DBADDR *paddr, struct dbr_ctrlDouble *pcd);
+
+rset pptFrameRSET = {
+    RSETNUMBER,
+    NULL,                   /* report */
+    NULL,                   /* initialize */
+    init_record,
+    process,
+    NULL,                   /* special */
+    NULL,                   /* get_value */
+    cvt_dbaddr,
+    get_array_info,
+    put_array_info,
+    get_units,
+    get_precision,
+    NULL,                   /* get_enum_str */
+    NULL,                   /* get_enum_strs */
+    NULL,                   /* put_enum_str */
+    get_graphic_double,
+    get_control_double,
+    NULL                    /* get_alarm_double */
+};
+epicsExportAddress(rset, pptFrameRSET);
+
+/* Decoded channels, THV..GST are contiguous DOUBLE fields */
+static double *channelFields(pptFrameRecord *prec) {
+    return &prec->thv;
+}
+
+/* Channel number of a field address, -1 for other fields */
+static int fieldChannel(const DBADDR *paddr) {
+    int index = dbGetFieldIndex(paddr);
+
+    if (index < pptFrameRecordTHV || index > pptFrameRecordGST)
+        return -1;
+    return index - pptFrameRecordTHV;
+}
+
+static long init_record(dbCommon *pcommon, int pass) {
+    pptFrameRecord *prec = (pptFrameRecord *)pcommon;
+    pptFramedset *pdset = (pptFramedset *)prec->dset;
+    int c;
+
+    if (pass == 0) {
+        double *chan = channelFields(prec);
+        for (c = 0; c < ppt::kNumChannels; c++)
+            chan[c] = 0.0;
+        return 0;
+    }
+
+    if (!pdset) {
+        recGblRecordError(S_dev_noDSET, prec, "pptFrame: init_record");
+        return S_dev_noDSET;
+    }
+    if (pdset->common.number < 5 || !pdset->read_frame) {
+        recGblRecordError(S_dev_missingSup, prec, "pptFrame: init_record");
+        return S_dev_missingSup;
+    }
+    if (pdset->common.init_record)
+        return pdset->common.init_record(pcommon);
+    return 0;
+}
+
+/*
+ * Validate and decode RAW. Returns a bit per channel field whose value
+ * changed; *wordsChanged tells whether any raw word moved.
+ */
+static epicsUInt64 decodeFrame(pptFrameRecord *prec, int *wordsChanged) {
+    ppt::FrameView frame(prec->raw);
+    double *chan = channelFields(prec);
+    epicsUInt64 changed = 0;
+    epicsTimeStamp now;
+    int c, w;
+
+    *wordsChanged = 0;
+    if (prec->nraw < (epicsUInt32)ppt::kFrameBytes) {
+        prec->fail = 0;
+        prec->rej = 1;
+        prec->nrej++;
+        recGblSetSevr(prec, READ_ALARM, INVALID_ALARM);
+        return 0;
+    }
+
+    epicsTimeGetCurrent(&now);
+    *wordsChanged = ppt::trackChanges(frame, prec->wrds, prec->wchg, prec->wlct,
+                                      now.secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH +
+                                      now.nsec * 1e-9, prec->nfrm > 0);
+    prec->nfrm++;
+
+    prec->fail = ppt::validateFrame(frame, prec->qual);
+    for (w = 0; w < ppt::kFrameWords; w++)
+        prec->viol[w] += prec->qual[w] != 0;
+
+    prec->rej = prec->fail > prec->maxf;
+    if (prec->rej) {
+        prec->nrej++;
+        recGblSetSevr(prec, READ_ALARM, INVALID_ALARM);
+        return 0;
+    }
+
+    for (c = 0; c < ppt::kNumChannels; c++) {
+        double value = ppt::channelValue(frame, c, prec->qual);
+
+        /* Bitwise compare, so NaN -> NaN is no change */
+        if (memcmp(&value, &chan[c], sizeof(value)) != 0) {
+            chan[c] = value;
+            changed |= (epicsUInt64)1 << c;
+        }
+    }
+    prec->val++;
+    prec->udf = FALSE;
+    return changed;
+}
+
+static void fillSnapshot(pptFrameRecord *prec) {
+    const double *chan = channelFields(prec);
+    double *snap = prec->snap;
+    int c, w;
+
+    snap[kSnapTime] = prec->time.secPastEpoch + POSIX_TIME_AT_EPICS_EPOCH +
+                      prec->time.nsec * 1e-9;
+    snap[kSnapFrames] = prec->val;
+    snap[kSnapFailed] = prec->fail;
+    snap[kSnapRejected] = prec->rej;
+    for (c = 0; c < ppt::kNumChannels; c++)
+        snap[kSnapChannels + c] = chan[c];
+    for (w = 0; w < ppt::kFrameWords; w++)
+        snap[kSnapQuality + w] = prec->qual[w];
+}
+
+static void monitor(pptFrameRecord *prec, epicsUInt64 changed, int wordsChanged,
+                    epicsInt32 oldFail, epicsUInt8 oldRej) {
+    unsigned short alarmMask = recGblResetAlarms(prec);
+    unsigned short valueMask = alarmMask | DBE_VALUE | DBE_LOG;
+    double *chan = channelFields(prec);
+    int c;
+
+    db_post_events(prec, &prec->val, valueMask);
+    db_post_events(prec, prec->raw, valueMask);
+    db_post_events(prec, prec->qual, valueMask);
+    db_post_events(prec, prec->snap, valueMask);
+    if (wordsChanged) {
+        db_post_events(prec, prec->wrds, valueMask);
+        db_post_events(prec, prec->wchg, valueMask);
+        db_post_events(prec, prec->wlct, valueMask);
+    }
+    if (prec->fail != oldFail || alarmMask) {
+        db_post_events(prec, &prec->fail, valueMask);
+        db_post_events(prec, prec->viol, valueMask);
+    }
+    if (prec->rej != oldRej || prec->rej || alarmMask) {
+        db_post_events(prec, &prec->rej, valueMask);
+        db_post_events(prec, &prec->nrej, valueMask);
+    }
+
+    /* Channels: on change, and all of them when the record alarm changed */
+    for (c = 0; c < ppt::kNumChannels; c++) {
+        if (changed & ((epicsUInt64)1 << c))
+            db_post_events(prec, &chan[c], valueMask);
+        else if (alarmMask)
+            db_post_events(prec, &chan[c], alarmMask);
+    }
+}
+
+static long process(dbCommon *pcommon) {
+    pptFrameRecord *prec = (pptFrameRecord *)pcommon;
+    pptFramedset *pdset = (pptFramedset *)prec->dset;
+    unsigned char pact = prec->pact;
+    epicsInt32 oldFail = prec->fail;
+    epicsUInt8 oldRej = prec->rej;
+    epicsUInt64 changed = 0;
+    int wordsChanged = 0;
+    long status;
+
+    if (!pdset || !pdset->read_frame) {
+        prec->pact = TRUE;
+        recGblRecordError(S_dev_missingSup, prec, "read_frame");
+        return S_dev_missingSup;
+    }
+
+    status = pdset->read_frame(prec);
+
+    /* Asynchronous device support started a read */
+    if (!pact && prec->pact)
+        return 0;
+
+    prec->pact = TRUE;
+    recGblGetTimeStamp(prec);
+    if (status == 0)
+        changed = decodeFrame(prec, &wordsChanged);
+    fillSnapshot(prec);
+
+    monitor(prec, changed, wordsChanged, oldFail, oldRej);
+    recGblFwdLink(prec);
+    prec->pact = FALSE;
+    return status;
+}
+
+static long cvt_dbaddr(DBADDR *paddr) {
+    pptFrameRecord *prec = (pptFrameRecord *)paddr->precord;
+
+    switch (dbGetFieldIndex(paddr)) {
+    case pptFrameRecordRAW:
+        paddr->pfield = prec->raw;
+        paddr->no_elements = ppt::kFrameBytes;
+        paddr->field_type = DBF_UCHAR;
+        paddr->field_size = sizeof(epicsUInt8);
+        break;
+    case pptFrameRecordWRDS:
+        paddr->pfield = prec->wrds;
+        paddr->no_elements = ppt::kFrameWords;
+        paddr->field_type = DBF_USHORT;
+        paddr->field_size = sizeof(epicsUInt16);
+        break;
+    case pptFrameRecordQUAL:
+        paddr->pfield = prec->qual;
+        paddr->no_elements = ppt::kFrameWords;
+        paddr->field_type = DBF_UCHAR;
+        paddr->field_size = sizeof(epicsUInt8);
+        break;
+    case pptFrameRecordVIOL:
+        paddr->pfield = prec->viol;
+        paddr->no_elements = ppt::kFrameWords;
+        paddr->field_type = DBF_ULONG;
+        paddr->field_size = sizeof(epicsUInt32);
+        break;
+    case pptFrameRecordWCHG:
+        paddr->pfield = prec->wchg;
+        paddr->no_elements = ppt::kFrameWords;
+        paddr->field_type = DBF_ULONG;
+        paddr->field_size = sizeof(epicsUInt32);
+        break;
+    case pptFrameRecordWLCT:
+        paddr->pfield = prec->wlct;
+        paddr->no_elements = ppt::kFrameWords;
+        paddr->field_type = DBF_DOUBLE;
+        paddr->field_size = sizeof(double);
+        break;
+    case pptFrameRecordSNAP:
+        paddr->pfield = prec->snap;
+        paddr->no_elements = kSnapSize;
+        paddr->field_type = DBF_DOUBLE;
+        paddr->field_size = sizeof(double);
+        break;
+    default:
+        return S_db_badField;
+    }
+    paddr->dbr_field_type = paddr->field_type;
+    return 0;
+}
+
+static long get_array_info(DBADDR *paddr, long *no_elements, long *offset) {
+    pptFrameRecord *prec = (pptFrameRecord *)paddr->precord;
+
+    if (dbGetFieldIndex(paddr) == pptFrameRecordRAW)
+        *no_elements = prec->nraw < (epicsUInt32)ppt::kFrameBytes ? prec->nraw
+                                                                  : ppt::kFrameBytes;
+    else
+        *no_elements = paddr->no_elements;
+    *offset = 0;
+    return 0;
+}
+
+/* A put to RAW injects a frame for the next process (tests, replay) */
+static long put_array_info(DBADDR *paddr, long nNew) {
+    pptFrameRecord *prec = (pptFrameRecord *)paddr->precord;
+
+    if (dbGetFieldIndex(paddr) == pptFrameRecordRAW)
+        prec->nraw = nNew;
+    return 0;
+}
+
+static long get_units(DBADDR *paddr, char *units) {
+    int c = fieldChannel(paddr);
+
+    if (c >= 0)
+        strncpy(units, ppt::channelMap[c].units, DB_UNITS_SIZE);
+    else if (dbGetFieldIndex(paddr) == pptFrameRecordWLCT)
+        strncpy(units, "s", DB_UNITS_SIZE);
+    else
+        units[0] = '\0';
+    return 0;
+}
+
+static long get_precision(const DBADDR *paddr, long *precision) {
+    pptFrameRecord *prec = (pptFrameRecord *)paddr->precord;
+    int c = fieldChannel(paddr);
+
+    if (c >= 0)
+        *precision = ppt::channelMap[c].kind == ppt::kAnalog ? prec->prec : 0;
+    else if (dbGetFieldIndex(paddr) == pptFrameRecordWLCT)
+        *precision = 3;
+    else
+        recGblGetPrec(paddr, precision);
+    return 0;
+}
+
+/* Display range of a channel: the documented range of its word */
+static void channelRange(int c, double *lower, double *upper) {
+    const ppt::ChannelInfo &ch = ppt::channelMap[c];
+
+    *lower = 0.0;
+    *upper = ppt::wordMap[ch.word].maxValue / ch.scale;
+}
+
+static long get_graphic_double(DBADDR *paddr, struct dbr_grDouble *pgd) {
+    int c = fieldChannel(paddr);
+
+    if (c >= 0)
+        channelRange(c, &pgd->lower_disp_limit, &pgd->upper_disp_limit);
+    else
+        recGblGetGraphicDouble(paddr, pgd);
+    return 0;
+}
+
+static long get_control_double(DBADDR *paddr, struct dbr_ctrlDouble *pcd) {
+    int c = fieldChannel(paddr);
+
+    if (c >= 0)
+        channelRange(c, &pcd->lower_ctrl_limit, &pcd->upper_ctrl_limit);
+    else
+        recGblGetControlDouble(paddr, pcd);
+    return 0;
+}
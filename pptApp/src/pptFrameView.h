@@ -0,0 +1,186 @@
+/*
+ * pptFrameView.h
+ *
+ * Zero-copy typed view of one 86-byte PPT Modulator frame (header only)
+ *
+ * A FrameView wraps a pointer to a received frame - the RawData waveform,
+ * a Framer output or a recording - so every stage of the pipeline reads
+ * the same buffer. Fields are types: the word number, byte order and
+ * scaling are compile-time constants, an unknown field name or a word
+ * outside the frame does not compile.
+ *
+ *   ppt::FrameView frame((const uint8_t *)prec->a);
+ *   double kV = frame.value<ppt::field::HVPSChargingVoltage>();
+ *   for (ppt::InterlockWord w : frame.interlocks())
+ *       if (w.bits) ...
+ *
+ * Byte order: analog words are sent MSB first, status/interlock words,
+ * the clipper counter and the reserved words LSB first.
+ */
+
+#ifndef PPTFRAMEVIEW_H
+#define PPTFRAMEVIEW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ppt {
+
+const int kFrameBytes = 86;
+const int kFrameWords = 43;
+
+/* Words sent LSB first: 5,6, 16,17, 24,25, 28-33, 36-42 */
+const uint64_t kLsbFirstWords =
+    (3ull << 5) | (3ull << 16) | (3ull << 24) | (0x3Full << 28) | (0x7Full << 36);
+
+inline constexpr bool wordLsbFirst(int word)
+{
+    return (kLsbFirstWords >> word) & 1;
+}
+
+inline uint16_t loadWord(const uint8_t *p, bool lsbFirst)
+{
+    return lsbFirst ? (uint16_t)(p[0] | (p[1] << 8))
+                    : (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/* A 16-bit field: engineering value = raw / Divisor */
+template <int Word, int Divisor = 1>
+struct Field {
+    static_assert(Word >= 0 && Word < kFrameWords, "word outside the 86-byte frame");
+    static_assert(Divisor > 0, "divisor must be positive");
+
+    enum { word = Word, offset = 2 * Word, divisor = Divisor };
+    static constexpr bool lsbFirst = wordLsbFirst(Word);
+};
+
+/* Fields of the register map (IF-MOD2128C Rev 2.1) */
+namespace field {
+/* Thyratron (bytes 0-13) */
+typedef Field<0, 10>  ThyHeaterVoltage;         /* V */
+typedef Field<1, 10>  ThyReservoirVoltage;      /* V */
+typedef Field<2, 100> ThyTotalCurrent;          /* A */
+typedef Field<3>      ThyTimerPreheatMin;
+typedef Field<4>      ThyTimerPreheatSec;
+typedef Field<5>      ThyInterlock;
+typedef Field<6>      ThyStatus;
+/* Klystron (bytes 14-35) */
+typedef Field<7, 10>  KlysHeaterVoltage;        /* V */
+typedef Field<8, 10>  KlysHeaterCurrent;        /* A */
+typedef Field<9, 10>  KlysBodyWaterInTemp;      /* C */
+typedef Field<10, 10> KlysBodyWaterOutTemp;     /* C */
+typedef Field<11, 10> KlysBodyWaterFlow;        /* L/Hour */
+typedef Field<12, 10> KlysDissipatedPower;      /* kW */
+typedef Field<13, 10> KlysOilTemp;              /* C */
+typedef Field<14>     KlysTimerPreheat100Min;
+typedef Field<15>     KlysTimerPreheat100Sec;
+typedef Field<16>     KlysInterlock;
+typedef Field<17>     KlysStatus;
+/* Focus magnet (bytes 36-51) */
+typedef Field<18, 10> FocusCoil1Voltage;        /* V */
+typedef Field<19, 10> FocusCoil1Current;        /* A */
+typedef Field<20, 10> FocusCoil2Voltage;        /* V */
+typedef Field<21, 10> FocusCoil2Current;        /* A */
+typedef Field<22, 10> FocusCoil3Voltage;        /* V */
+typedef Field<23, 10> FocusCoil3Current;        /* A */
+typedef Field<24>     FocusInterlock;
+typedef Field<25>     FocusStatus;
+/* Premagnetisation (bytes 52-59) */
+typedef Field<26, 10> PremagVoltage;            /* V */
+typedef Field<27, 10> PremagCurrent;            /* A */
+typedef Field<28>     PremagInterlock;
+typedef Field<29>     PremagStatus;
+/* Waveguide/VSWR/Clipper (bytes 60-67) */
+typedef Field<30>     WaveguideInterlock;
+typedef Field<31>     VSWRInterlock;
+typedef Field<32>     ClipperInterlock;
+typedef Field<33>     Counter;
+/* HVPS + General (bytes 68-79) */
+typedef Field<34>     HVPSChargingVoltage;      /* 0.1 kV, scaled by the ai record */
+typedef Field<35, 10> HVPSWaterTemperature;     /* C */
+typedef Field<36>     HVPSInterlock;
+typedef Field<37>     HVPSStatus;
+typedef Field<38>     GeneralInterlock;
+typedef Field<39>     GeneralStatus;
+} // namespace field
+
+/* Words carrying interlock bits, in frame order */
+const int kNumInterlockWords = 9;
+const int interlockWords[kNumInterlockWords] = {
+    field::ThyInterlock::word, field::KlysInterlock::word,
+    field::FocusInterlock::word, field::PremagInterlock::word,
+    field::WaveguideInterlock::word, field::VSWRInterlock::word,
+    field::ClipperInterlock::word, field::HVPSInterlock::word,
+    field::GeneralInterlock::word
+};
+
+struct InterlockWord {
+    int word;
+    uint16_t bits;
+};
+
+class FrameView {
+public:
+    /* data must hold kFrameBytes bytes and outlive the view */
+    explicit FrameView(const uint8_t *data) : data_(data) {}
+
+    const uint8_t *data() const { return data_; }
+
+    /* Raw word by number, byte order from the register map */
+    uint16_t word(int w) const { return loadWord(data_ + 2 * w, wordLsbFirst(w)); }
+
+    template <class F>
+    uint16_t raw() const { return loadWord(data_ + F::offset, F::lsbFirst); }
+
+    template <class F>
+    double value() const { return raw<F>() / (double)F::divisor; }
+
+    template <class F>
+    bool bit(int b) const { return (raw<F>() >> b) & 1; }
+
+    /* Range over the interlock words: for (InterlockWord w : v.interlocks()) */
+    class InterlockIterator {
+    public:
+        InterlockIterator(const uint8_t *data, int index) : data_(data), index_(index) {}
+        InterlockWord operator*() const {
+            int w = interlockWords[index_];
+            InterlockWord iw = { w, loadWord(data_ + 2 * w, wordLsbFirst(w)) };
+            return iw;
+        }
+        InterlockIterator &operator++() { index_++; return *this; }
+        bool operator!=(const InterlockIterator &o) const { return index_ != o.index_; }
+    private:
+        const uint8_t *data_;
+        int index_;
+    };
+
+    struct InterlockRange {
+        const uint8_t *data;
+        InterlockIterator begin() const { return InterlockIterator(data, 0); }
+        InterlockIterator end() const { return InterlockIterator(data, kNumInterlockWords); }
+    };
+
+    InterlockRange interlocks() const { InterlockRange r = { data_ }; return r; }
+
+    /* True if any interlock bit is set */
+    bool anyInterlock() const {
+        uint16_t any = 0;
+        for (int i = 0; i < kNumInterlockWords; i++)
+            any |= word(interlockWords[i]);
+        return any != 0;
+    }
+
+private:
+    const uint8_t *data_;
+};
+
+/* Owned storage for one frame, e.g. the output of ppt::Framer */
+struct alignas(8) FrameBuffer {
+    uint8_t bytes[kFrameBytes];
+
+    FrameView view() const { return FrameView(bytes); }
+};
+
+} // namespace ppt
+
+#endif /* PPTFRAMEVIEW_H */
@@ -0,0 +1,97 @@
+/*
+ * pptFramer.cpp
+ *
+ * Frame alignment for the PPT Modulator byte stream (see pptFramer.h)
+ */
+
+#include "pptFramer.h"
+
+namespace ppt {
+
+Framer::Framer(int maxFailures)
+    : head_(0), maxFailures_(maxFailures), locked_(false),
+      resyncs_(0), droppedBytes_(0)
+{
+    buf_.reserve(4 * kFrameBytes);
+}
+
+void Framer::push(const uint8_t *data, size_t len)
+{
+    /* Compact once the consumed part dominates the buffer */
+    if (head_ > 0 && head_ >= buf_.size() - head_) {
+        buf_.erase(buf_.begin(), buf_.begin() + head_);
+        head_ = 0;
+    }
+    buf_.insert(buf_.end(), data, data + len);
+}
+
+int Framer::failures(size_t offset, uint8_t *quality) const
+{
+    return validateFrame(FrameView(&buf_[head_ + offset]), quality);
+}
+
+void Framer::drop(size_t count)
+{
+    head_ += count;
+    droppedBytes_ += count;
+}
+
+void Framer::take(FrameBuffer &frame)
+{
+    const uint8_t *src = &buf_[head_];
+    for (int i = 0; i < kFrameBytes; i++)
+        frame.bytes[i] = src[i];
+    head_ += kFrameBytes;
+    locked_ = true;
+}
+
+bool Framer::pop(FrameBuffer &frame, uint8_t *quality)
+{
+    uint8_t scratch[kFrameWords];
+
+    if (!quality)
+        quality = scratch;
+    while (buffered() >= (size_t)kFrameBytes) {
+        int failed = failures(0, quality);
+        if (failed == 0 || (locked_ && failed <= maxFailures_)) {
+            take(frame);
+            return true;
+        }
+
+        /* Wait until every offset of a whole frame can be compared */
+        if (buffered() < 2 * (size_t)kFrameBytes - 1)
+            break;
+
+        size_t best = 0;
+        int bestFailed = failed;
+        for (size_t offset = 1; offset < (size_t)kFrameBytes && bestFailed; offset++) {
+            int f = failures(offset, scratch);
+            if (f < bestFailed) {
+                best = offset;
+                bestFailed = f;
+            }
+        }
+
+        resyncs_++;
+        locked_ = false;
+        if (bestFailed > maxFailures_) {
+            drop(kFrameBytes);      /* no usable alignment in this frame */
+            continue;
+        }
+        drop(best);
+        failures(0, quality);       /* flags of the new alignment */
+        take(frame);
+        return true;
+    }
+    return false;
+}
+
+void Framer::reset()
+{
+    droppedBytes_ += buffered();
+    buf_.clear();
+    head_ = 0;
+    locked_ = false;
+}
+
+} // namespace ppt
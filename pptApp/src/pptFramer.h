@@ -0,0 +1,59 @@
+/*
+ * pptFramer.h
+ *
+ * Splits the byte stream received from the modulator into 86-byte frames.
+ *
+ * The modulator sends frames without header or terminator, so alignment
+ * is recovered from the register map. Until it is locked, the framer
+ * compares all 86 byte offsets and keeps the one with the fewest failed
+ * validateFrame() checks, dropping the bytes before it. Once locked, a
+ * frame is accepted as long as it fails at most maxFailures checks.
+ * pop() also returns the quality flags it validated the frame with, so
+ * the caller does not have to validate it again.
+ */
+
+#ifndef PPTFRAMER_H
+#define PPTFRAMER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "pptProto.h"
+
+namespace ppt {
+
+class Framer {
+public:
+    explicit Framer(int maxFailures = 4);
+
+    /* Append received bytes */
+    void push(const uint8_t *data, size_t len);
+
+    /* Extract the next aligned frame and its kFrameWords quality flags */
+    bool pop(FrameBuffer &frame, uint8_t *quality = NULL);
+
+    /* Drop buffered bytes, e.g. after a read timeout or reconnect */
+    void reset();
+
+    void setMaxFailures(int maxFailures) { maxFailures_ = maxFailures; }
+    size_t buffered() const { return buf_.size() - head_; }
+    unsigned long resyncs() const { return resyncs_; }
+    unsigned long droppedBytes() const { return droppedBytes_; }
+
+private:
+    int failures(size_t offset, uint8_t *quality) const;
+    void drop(size_t count);
+    void take(FrameBuffer &frame);
+
+    std::vector<uint8_t> buf_;
+    size_t head_;
+    int maxFailures_;
+    bool locked_;
+    unsigned long resyncs_;
+    unsigned long droppedBytes_;
+};
+
+} // namespace ppt
+
+#endif /* PPTFRAMER_H */
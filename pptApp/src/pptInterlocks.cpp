@@ -0,0 +1,156 @@
+/*
+ * pptInterlocks.cpp
+ *
+ * Interlock summary of one frame, see pptInterlocks.h
+ */
+
+#include <string.h>
+
+#include "pptInterlocks.h"
+#include "pptProto.h"
+
+namespace ppt {
+
+const char *const interlockSubsystems[kNumInterlockWords] = {
+    "Thy", "Klys", "Focus", "Premag", "Waveguide", "VSWR", "Clipper", "HVPS", "General"
+};
+
+namespace {
+
+/* Per interlock word: named bits, severities and names from bitMap */
+struct InterlockTables {
+    uint16_t named[kNumInterlockWords];
+    uint16_t major[kNumInterlockWords];
+    uint16_t minor[kNumInterlockWords];
+    const char *names[kNumInterlockWords][16];
+
+    InterlockTables() {
+        memset(this, 0, sizeof(*this));
+        for (size_t n = 0; n < numBits; n++) {
+            const BitInfo &info = bitMap[n];
+            uint16_t bit = (uint16_t)(1u << info.bit);
+
+            if (info.severity == kStatusBit)
+                continue;
+            for (int i = 0; i < kNumInterlockWords; i++) {
+                if (interlockWords[i] != info.word)
+                    continue;
+                named[i] |= bit;
+                if (info.severity == kMajorInterlock)
+                    major[i] |= bit;
+                else
+                    minor[i] |= bit;
+                names[i][info.bit] = info.name;
+            }
+        }
+    }
+};
+
+const InterlockTables &tables()
+{
+    static const InterlockTables t;
+    return t;
+}
+
+int bitCount(uint16_t bits)
+{
+    int count = 0;
+    for (; bits; bits &= bits - 1)
+        count++;
+    return count;
+}
+
+int lowestBit(uint16_t bits)
+{
+    int b = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        b++;
+    }
+    return b;
+}
+
+} // namespace
+
+const char *interlockName(int index, int bit)
+{
+    if (index < 0 || index >= kNumInterlockWords || bit < 0 || bit > 15)
+        return NULL;
+    return tables().names[index][bit];
+}
+
+void summarizeInterlocks(FrameView frame, const uint8_t *quality, InterlockSummary &summary)
+{
+    const InterlockTables &t = tables();
+    uint16_t major = 0, minor = 0;
+    bool invalid = false;
+
+    summary.subsystems = 0;
+    summary.count = 0;
+    summary.numNames = 0;
+    for (int i = 0; i < kNumInterlockWords; i++) {
+        int w = interlockWords[i];
+        uint16_t bits = frame.word(w) & t.named[i];
+
+        summary.active[i] = bits;
+        summary.subsystems |= (uint32_t)(bits != 0) << i;
+        summary.count += bitCount(bits);
+        major |= bits & t.major[i];
+        minor |= bits & t.minor[i];
+        if (quality)
+            invalid |= quality[w] != 0;
+        for (; bits && summary.numNames < kMaxActiveNames; bits &= bits - 1)
+            summary.names[summary.numNames++] = t.names[i][lowestBit(bits)];
+    }
+
+    if (invalid)
+        summary.severity = kInterlocksInvalid;
+    else if (major)
+        summary.severity = kInterlocksMajor;
+    else if (minor)
+        summary.severity = kInterlocksMinor;
+    else
+        summary.severity = kInterlocksOk;
+}
+
+InterlockLatch::InterlockLatch(double holdTime)
+    : holdTime_(holdTime)
+{
+    memset(live_, 0, sizeof(live_));
+    memset(latched_, 0, sizeof(latched_));
+    memset(held_, 0, sizeof(held_));
+    for (int i = 0; i < kNumInterlockWords; i++)
+        for (int b = 0; b < 16; b++)
+            lastSeen_[i][b] = -1e300;
+}
+
+void InterlockLatch::update(FrameView frame, const uint8_t *quality, double time)
+{
+    const InterlockTables &t = tables();
+
+    for (int i = 0; i < kNumInterlockWords; i++) {
+        int w = interlockWords[i];
+        uint16_t held = 0;
+
+        if (!quality || !quality[w]) {
+            uint16_t bits = frame.word(w) & t.named[i];
+            live_[i] = bits;
+            latched_[i] |= bits;
+            for (; bits; bits &= bits - 1)
+                lastSeen_[i][lowestBit(bits)] = time;
+        }
+        for (uint16_t bits = t.named[i]; bits; bits &= bits - 1) {
+            int b = lowestBit(bits);
+            if (time - lastSeen_[i][b] < holdTime_)
+                held |= (uint16_t)(1u << b);
+        }
+        held_[i] = held | live_[i];
+    }
+}
+
+void InterlockLatch::acknowledge()
+{
+    memcpy(latched_, live_, sizeof(latched_));
+}
+
+} // namespace ppt
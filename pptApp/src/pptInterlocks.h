@@ -0,0 +1,89 @@
+/*
+ * pptInterlocks.h
+ *
+ * Interlock summary of one frame
+ *
+ * One pass over the nine interlock words of the register map gives the
+ * active interlock bits, their number, the highest severity (bitMap),
+ * the tripped subsystems and the names of the active interlocks, so
+ * displays and the sequencer can watch a handful of values instead of
+ * every interlock bit.
+ *
+ * InterlockLatch keeps images of the same words that do not lose a bit set
+ * for a single frame: latched holds every bit seen until acknowledged,
+ * held shows every bit for at least a minimum hold time.
+ */
+
+#ifndef PPTINTERLOCKS_H
+#define PPTINTERLOCKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pptFrameView.h"
+
+namespace ppt {
+
+/* Highest severity of the active interlocks */
+enum InterlockSeverity {
+    kInterlocksOk,
+    kInterlocksMinor,
+    kInterlocksMajor,
+    kInterlocksInvalid      /* an interlock word failed validation */
+};
+
+/* Subsystem of each interlock word, e.g. "Thy" for word 5 */
+extern const char *const interlockSubsystems[kNumInterlockWords];
+
+const int kMaxActiveNames = 16;
+
+struct InterlockSummary {
+    uint16_t active[kNumInterlockWords];    /* named interlock bits set, per word */
+    uint32_t subsystems;                    /* bit i: interlockWords[i] tripped */
+    int count;                              /* active interlock bits */
+    InterlockSeverity severity;
+    int numNames;
+    const char *names[kMaxActiveNames];     /* bitMap names, frame order */
+};
+
+/*
+ * Summarise the interlock words of frame. quality (kFrameWords flags from
+ * validateFrame, may be NULL) marks words whose state is unknown.
+ */
+void summarizeInterlocks(FrameView frame, const uint8_t *quality, InterlockSummary &summary);
+
+/* bitMap name of bit b of interlock word index i, NULL if unnamed */
+const char *interlockName(int index, int bit);
+
+class InterlockLatch {
+public:
+    explicit InterlockLatch(double holdTime = 2.0);
+
+    /*
+     * OR the named interlock bits of frame, received at time (seconds),
+     * into the images. Words flagged in quality (may be NULL) are skipped.
+     */
+    void update(FrameView frame, const uint8_t *quality, double time);
+
+    /* Clear the latched bits that are no longer set */
+    void acknowledge();
+
+    void setHoldTime(double seconds) { holdTime_ = seconds; }
+    double holdTime() const { return holdTime_; }
+
+    /* Images of interlock word index i (interlockWords order) */
+    uint16_t live(int i) const { return live_[i]; }
+    uint16_t latched(int i) const { return latched_[i]; }
+    uint16_t held(int i) const { return held_[i]; }
+
+private:
+    double holdTime_;
+    uint16_t live_[kNumInterlockWords];
+    uint16_t latched_[kNumInterlockWords];
+    uint16_t held_[kNumInterlockWords];
+    double lastSeen_[kNumInterlockWords][16];
+};
+
+} // namespace ppt
+
+#endif /* PPTINTERLOCKS_H */
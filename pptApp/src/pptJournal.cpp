@@ -0,0 +1,182 @@
+/*
+ * pptJournal.cpp
+ *
+ * Memory-mapped command journal, see pptJournal.h (POSIX)
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pptJournal.h"
+
+namespace ppt {
+
+namespace {
+
+const char kMagic[8] = "PPTJRNL";
+const uint32_t kVersion = 1;
+const size_t kNamesOffset = 64;
+const size_t kEntriesOffset = 4096;
+
+/* Prefault the mapping: no page fault on the first append to a page */
+#ifdef MAP_POPULATE
+const int kMapFlags = MAP_SHARED | MAP_POPULATE;
+#else
+const int kMapFlags = MAP_SHARED;
+#endif
+
+} // namespace
+
+CommandJournal::CommandJournal()
+    : map_(NULL), size_(0), header_(NULL), names_(NULL), entries_(NULL), capacity_(0)
+{
+}
+
+CommandJournal::~CommandJournal()
+{
+    close();
+}
+
+bool CommandJournal::open(const char *filename, size_t capacity, bool writable,
+                          std::string &error)
+{
+    JournalHeader header;
+    struct stat st;
+    bool create;
+    int fd;
+
+    close();
+    fd = ::open(filename, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        error = strerror(errno);
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+    create = writable && st.st_size == 0;
+    if (create) {
+        if (capacity == 0)
+            capacity = kJournalCapacity;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.entrySize = sizeof(JournalEntry);
+        header.capacity = capacity;
+        header.sources = kSourceFirstClient;
+        if (ftruncate(fd, kEntriesOffset + capacity * sizeof(JournalEntry)) != 0) {
+            error = strerror(errno);
+            ::close(fd);
+            return false;
+        }
+    } else if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+               memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+               header.version != kVersion || header.entrySize != sizeof(JournalEntry) ||
+               header.capacity == 0 || header.sources > (uint32_t)kJournalSources ||
+               (uint64_t)st.st_size != kEntriesOffset + header.capacity * sizeof(JournalEntry)) {
+        error = "not a command journal of this version";
+        ::close(fd);
+        return false;
+    }
+
+    size_ = kEntriesOffset + header.capacity * sizeof(JournalEntry);
+    map_ = mmap(NULL, size_, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                writable ? kMapFlags : MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED) {
+        error = strerror(errno);
+        map_ = NULL;
+        return false;
+    }
+    header_ = (JournalHeader *)map_;
+    names_ = (char (*)[kJournalNameSize])((char *)map_ + kNamesOffset);
+    entries_ = (JournalEntry *)((char *)map_ + kEntriesOffset);
+    capacity_ = header.capacity;
+    filename_ = filename;
+    if (create) {
+        *header_ = header;
+        strcpy(names_[kSourceLocal], "local");
+        strcpy(names_[kSourceRamp], "ramp");
+        strcpy(names_[kSourceIoc], "ioc");
+        strcpy(names_[kSourceOther], "other");
+    }
+    return true;
+}
+
+void CommandJournal::close()
+{
+    if (!map_)
+        return;
+    if (msync(map_, size_, MS_SYNC) != 0)
+        perror(filename_.c_str());
+    munmap(map_, size_);
+    map_ = NULL;
+    header_ = NULL;
+    names_ = NULL;
+    entries_ = NULL;
+    capacity_ = 0;
+}
+
+int CommandJournal::source(const char *name)
+{
+    uint32_t i;
+
+    for (i = kSourceFirstClient; i < header_->sources; i++)
+        if (strncmp(names_[i], name, kJournalNameSize - 1) == 0)
+            return i;
+    if (i == (uint32_t)kSourceOther)
+        return kSourceOther;
+    snprintf(names_[i], kJournalNameSize, "%s", name);
+    header_->sources = i + 1;
+    return i;
+}
+
+const char *CommandJournal::sourceName(int source) const
+{
+    if (source < 0 || ((uint32_t)source >= header_->sources && source != kSourceOther))
+        return "?";
+    return names_[source];
+}
+
+uint32_t CommandJournal::nextImage()
+{
+    return ++header_->images;
+}
+
+void CommandJournal::append(const JournalEntry &entry)
+{
+    entries_[header_->count % capacity_] = entry;
+    /* Readers trust count: the entry must be in memory first */
+    __sync_synchronize();
+    header_->count++;
+}
+
+uint64_t CommandJournal::count() const
+{
+    uint64_t count = header_->count;
+
+    __sync_synchronize();
+    return count;
+}
+
+uint64_t CommandJournal::first() const
+{
+    uint64_t count = this->count();
+
+    return count > capacity_ ? count - capacity_ : 0;
+}
+
+const char *journalOutcomeName(int outcome)
+{
+    static const char *names[kNumOutcomes] = {
+        "written", "write-error", "confirmed", "timeout", "superseded"
+    };
+
+    return outcome >= 0 && outcome < kNumOutcomes ? names[outcome] : "?";
+}
+
+} // namespace ppt
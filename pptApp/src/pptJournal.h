@@ -0,0 +1,137 @@
+/*
+ * pptJournal.h
+ *
+ * Command journal of pptDriver: every command image written to the
+ * modulator, appended to a memory-mapped file, for incident analysis
+ * (pptjournal prints, filters and replays it).
+ *
+ * Entries are never changed once appended. A command written in an image
+ * gets a Write entry: the time its put was received, the encoded CmdReg32
+ * image, who put it and whether the write succeeded. The images are
+ * numbered; a coalesced image has one Write entry per command, all with
+ * the same number. When the round trip of the command ends (pptLatency.h)
+ * a Result entry with that number records the outcome: confirmed by a
+ * frame, timed out, or superseded by an OFF (or the same command again)
+ * written before it completed.
+ * Commands without a status bit (Reset, the setpoint) get no Result. The
+ * image that clears the bits at the end of a command pulse (pptDriver,
+ * Cmd:PulseHold) is a Clear entry of its own number.
+ *
+ * The file is a ring of a fixed number of entries, written in place
+ * through the mapping: an append is a 32-byte store and no system call,
+ * so journaling adds nothing to the send path. The kernel writes the
+ * pages back; they survive an IOC crash, not a power loss before the
+ * write-back. When the ring is full the oldest entries are overwritten;
+ * the header counts all entries ever appended, so readers see where the
+ * ring starts. Reopening a journal appends to it.
+ *
+ * Sources: 0 local (no Channel Access client: iocsh, links, autosave),
+ * 1 the HV ramp, 2 Channel Access puts from the IOC's own user and host
+ * (pptAutoSeq), from 3 on "user@host" of other Channel Access clients,
+ * kept in the file's name table (OPIs, scripts). The last slot of the
+ * table, "other", takes all clients once the table is full.
+ *
+ * Layout, host byte order:
+ *   0     JournalHeader
+ *   64    source names, kJournalSources x kJournalNameSize
+ *   4096  entries, capacity x JournalEntry
+ */
+
+#ifndef PPTJOURNAL_H
+#define PPTJOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace ppt {
+
+enum JournalKind { kJournalWrite = 1, kJournalResult = 2, kJournalClear = 3 };
+
+enum JournalOutcome {
+    kOutcomeWritten,        /* Write: image written */
+    kOutcomeWriteError,     /* Write: write failed */
+    kOutcomeConfirmed,      /* Result: status bit followed */
+    kOutcomeTimeout,        /* Result: not within RoundTrip:Timeout */
+    kOutcomeSuperseded,     /* Result: OFF or repeat written before it completed */
+    kNumOutcomes
+};
+
+enum JournalSource { kSourceLocal, kSourceRamp, kSourceIoc, kSourceFirstClient };
+
+const int kJournalSources = 60;
+const int kSourceOther = kJournalSources - 1;   /* clients beyond the table */
+const int kJournalNameSize = 64;
+const size_t kJournalCapacity = 1 << 20;    /* 32 MB */
+
+struct JournalHeader {
+    char magic[8];          /* "PPTJRNL" */
+    uint32_t version;
+    uint32_t entrySize;
+    uint64_t capacity;      /* entries in the ring */
+    uint64_t count;         /* entries appended since creation */
+    uint32_t images;        /* number of the last image */
+    uint32_t sources;       /* names in the table */
+    char reserved[24];
+};
+
+struct JournalEntry {
+    uint64_t time;          /* ns since the Epoch: Write: put, Result: outcome,
+                               Clear: written */
+    uint32_t image;         /* image number */
+    uint32_t value;         /* Write, Clear: encoded CmdReg32 */
+    uint32_t latency;       /* us: Write: put to written, Result: written to outcome */
+    uint16_t kind;          /* JournalKind */
+    uint16_t command;       /* Command or kSetHV */
+    uint16_t source;        /* JournalSource or name table index */
+    uint16_t outcome;       /* JournalOutcome; Clear: written or write error */
+    uint32_t reserved;
+};
+
+class CommandJournal {
+public:
+    CommandJournal();
+    ~CommandJournal();
+
+    /*
+     * Map filename, creating it with capacity entries if it does not
+     * exist, read-only for the tools. False with error set if it is not
+     * a journal or cannot be mapped.
+     */
+    bool open(const char *filename, size_t capacity, bool writable, std::string &error);
+    void close();
+    bool isOpen() const { return header_ != NULL; }
+    const std::string &filename() const { return filename_; }
+
+    /* Index of a client name, added to the table; kSourceOther if full */
+    int source(const char *name);
+    const char *sourceName(int source) const;
+
+    /* Number for the next image */
+    uint32_t nextImage();
+    void append(const JournalEntry &entry);
+
+    uint64_t count() const;
+    uint64_t capacity() const { return capacity_; }
+    /* Oldest entry still in the ring, and entry i of 0..count() */
+    uint64_t first() const;
+    const JournalEntry &entry(uint64_t i) const { return entries_[i % capacity_]; }
+
+private:
+    CommandJournal(const CommandJournal &);
+    CommandJournal &operator=(const CommandJournal &);
+
+    std::string filename_;
+    void *map_;
+    size_t size_;
+    JournalHeader *header_;
+    char (*names_)[kJournalNameSize];
+    JournalEntry *entries_;
+    uint64_t capacity_;
+};
+
+const char *journalOutcomeName(int outcome);
+
+} // namespace ppt
+
+#endif /* PPTJOURNAL_H */
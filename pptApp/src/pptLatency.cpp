@@ -0,0 +1,112 @@
+/*
+ * pptLatency.cpp
+ *
+ * Latency histogram, see pptLatency.h
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pptLatency.h"
+
+namespace ppt {
+
+LatencyHistogram::LatencyHistogram()
+{
+    clear();
+}
+
+void LatencyHistogram::clear()
+{
+    count_ = 0;
+    timeouts_ = 0;
+    min_ = 0.0;
+    max_ = 0.0;
+    memset(buckets_, 0, sizeof(buckets_));
+}
+
+double LatencyHistogram::bucketLimit(int i)
+{
+    return pow(2.0, (i + 1) / 4.0);
+}
+
+void LatencyHistogram::add(double ms)
+{
+    int i = 0;
+
+    if (!(ms >= 0.0))
+        return;
+    if (ms > 1.0)
+        i = (int)ceil(4.0 * log2(ms)) - 1;
+    if (i < 0)
+        i = 0;
+    if (i >= kBuckets)
+        i = kBuckets - 1;
+    buckets_[i]++;
+    if (!count_ || ms < min_)
+        min_ = ms;
+    if (!count_ || ms > max_)
+        max_ = ms;
+    count_++;
+}
+
+double LatencyHistogram::quantile(double q) const
+{
+    uint64_t rank, sum = 0;
+
+    if (!count_)
+        return 0.0;
+    rank = (uint64_t)ceil(q * count_);
+    if (rank < 1)
+        rank = 1;
+    for (int i = 0; i < kBuckets; i++) {
+        sum += buckets_[i];
+        if (sum >= rank) {
+            double limit = i == kBuckets - 1 ? max_ : bucketLimit(i);
+            return limit < min_ ? min_ : limit > max_ ? max_ : limit;
+        }
+    }
+    return max_;
+}
+
+std::string LatencyHistogram::format() const
+{
+    char buf[64];
+    std::string line;
+
+    snprintf(buf, sizeof(buf), "%u %u %.6g %.6g", count_, timeouts_, min_, max_);
+    line = buf;
+    for (int i = 0; i < kBuckets; i++) {
+        snprintf(buf, sizeof(buf), " %u", buckets_[i]);
+        line += buf;
+    }
+    return line;
+}
+
+bool LatencyHistogram::parse(const char *line)
+{
+    LatencyHistogram h;
+    uint64_t sum = 0;
+    char *end;
+    int n;
+
+    if (sscanf(line, " %u %u %lf %lf%n", &h.count_, &h.timeouts_, &h.min_, &h.max_, &n) != 4)
+        return false;
+    line += n;
+    for (int i = 0; i < kBuckets; i++) {
+        unsigned long v = strtoul(line, &end, 10);
+        if (end == line)
+            return false;
+        h.buckets_[i] = (uint32_t)v;
+        sum += v;
+        line = end;
+    }
+    if (sum != h.count_)
+        return false;
+    *this = h;
+    return true;
+}
+
+} // namespace ppt
@@ -0,0 +1,59 @@
+/*
+ * pptLatency.h
+ *
+ * Latency histogram of the command round trips (pptDriver)
+ *
+ * Logarithmic buckets, four per octave from 1 ms: bucket i holds latencies
+ * up to bucketLimit(i) = 2^((i + 1) / 4) ms, the last one everything above
+ * (65 s). Quantiles are the limit of the bucket they fall in, so within
+ * 19 % of the true value, and never outside the exact min and max. Round
+ * trips that did not complete are counted as timeouts, not as latencies.
+ *
+ * The text form, one line, is what pptDriver persists across restarts:
+ *   count timeouts min max bucket0 ... bucket63
+ */
+
+#ifndef PPTLATENCY_H
+#define PPTLATENCY_H
+
+#include <stdint.h>
+#include <string>
+
+namespace ppt {
+
+class LatencyHistogram {
+public:
+    static const int kBuckets = 64;
+
+    LatencyHistogram();
+
+    void clear();
+    void add(double ms);
+    void addTimeout() { timeouts_++; }
+
+    uint32_t count() const { return count_; }
+    uint32_t timeouts() const { return timeouts_; }
+    double min() const { return count_ ? min_ : 0.0; }
+    double max() const { return count_ ? max_ : 0.0; }
+
+    /* Latency below which a fraction q (0..1) of the round trips fall, ms */
+    double quantile(double q) const;
+
+    const uint32_t *buckets() const { return buckets_; }
+    static double bucketLimit(int i);
+
+    std::string format() const;
+    /* Replace the contents by a format() line; false if malformed */
+    bool parse(const char *line);
+
+private:
+    uint32_t count_;
+    uint32_t timeouts_;
+    double min_;
+    double max_;
+    uint32_t buckets_[kBuckets];
+};
+
+} // namespace ppt
+
+#endif /* PPTLATENCY_H */
@@ -0,0 +1,336 @@
+/*
+ * pptProto.cpp
+ *
+ * Register map, channel and bit tables, validation, decoding and command
+ * encoding of the PPT Modulator protocol (see pptProto.h)
+ *
+ * Tables follow tcpip-interface-description_IF-MOD2128C_Rev2-1 and the
+ * PV names of ppt.template.
+ */
+
+#include <limits>
+
+#include "pptProto.h"
+
+namespace ppt {
+
+const WordInfo wordMap[kFrameWords] = {
+    /* Thyratron (bytes 0-13) */
+    { "Thy:HeaterVoltage",        100, 0xFFFF },
+    { "Thy:ReservoirVoltage",     100, 0xFFFF },
+    { "Thy:TotalCurrent",        1000, 0xFFFF },
+    { "Thy:TimerPreheatMin",       15, 0xFFFF },
+    { "Thy:TimerPreheatSec",       60, 0xFFFF },
+    { "Thy:InterlockRaw",      0xFFFF, 0x007F },   /* bits 0-6 */
+    { "Thy:StatusRaw",         0xFFFF, 0x0007 },   /* bits 0-2 */
+    /* Klystron (bytes 14-35) */
+    { "Klys:HeaterVoltage",       270, 0xFFFF },
+    { "Klys:HeaterCurrent",         6, 0xFFFF },
+    { "Klys:BodyWaterInTemp",     100, 0xFFFF },
+    { "Klys:BodyWaterOutTemp",    100, 0xFFFF },
+    { "Klys:BodyWaterFlow",       100, 0xFFFF },
+    { "Klys:DissipatedPower",    5000, 0xFFFF },
+    { "Klys:OilTemp",             100, 0xFFFF },
+    { "Klys:TimerPreheat100Min",   15, 0xFFFF },
+    { "Klys:TimerPreheat100Sec",   60, 0xFFFF },
+    { "Klys:InterlockRaw",     0xFFFF, 0xFFFF },   /* bits 0-15 */
+    { "Klys:StatusRaw",        0xFFFF, 0x001F },   /* bits 0-4 */
+    /* Focus magnet (bytes 36-51), Rev 2.1 ranges */
+    { "Focus:Coil1Voltage",      1320, 0xFFFF },
+    { "Focus:Coil1Current",       500, 0xFFFF },
+    { "Focus:Coil2Voltage",      1320, 0xFFFF },
+    { "Focus:Coil2Current",       500, 0xFFFF },
+    { "Focus:Coil3Voltage",      1320, 0xFFFF },
+    { "Focus:Coil3Current",       500, 0xFFFF },
+    { "Focus:InterlockRaw",    0xFFFF, 0x7FFF },   /* bits 0-14 */
+    { "Focus:StatusRaw",       0xFFFF, 0x0003 },   /* bits 0-1 */
+    /* Premagnetisation (bytes 52-59), Rev 2.1 ranges */
+    { "Premag:Voltage",           700, 0xFFFF },
+    { "Premag:Current",           200, 0xFFFF },
+    { "Premag:InterlockRaw",   0xFFFF, 0x008F },   /* bits 0-3, 7 */
+    { "Premag:StatusRaw",      0xFFFF, 0x0003 },   /* bits 0-1 */
+    /* Waveguide/VSWR/Clipper (bytes 60-67) */
+    { "Waveguide:InterlockRaw", 0xFFFF, 0xF3FF },  /* bits 0-9, 12-15 */
+    { "VSWR:InterlockRaw",     0xFFFF, 0x00FF },   /* bits 0-7 */
+    { "Clipper:InterlockRaw",  0xFFFF, 0x0007 },   /* bits 0-2 */
+    { "Counter",                  100, 0xFFFF },
+    /* HVPS + General (bytes 68-79) */
+    { "HVPS:ChargingVoltageRaw",  500, 0xFFFF },
+    { "HVPS:WaterTemperature",   1000, 0xFFFF },
+    { "HVPS:InterlockRaw",     0xFFFF, 0x00FF },   /* bits 0-7 */
+    { "HVPS:StatusRaw",        0xFFFF, 0x0007 },   /* bits 0-2 */
+    { "General:InterlockRaw",  0xFFFF, 0x07FF },   /* bits 0-10 */
+    { "General:StatusRaw",     0xFFFF, 0x07FF },   /* bits 0-10 */
+    /* Reserved/Control (bytes 80-85), not checked */
+    { "Reserved40",            0xFFFF, 0xFFFF },
+    { "Reserved41",            0xFFFF, 0xFFFF },
+    { "Reserved42",            0xFFFF, 0xFFFF },
+};
+
+/* Word and scale come from the field types of pptFrameView.h */
+#define CHANNEL(name, f, units, kind) \
+    { name, field::f::word, (double)field::f::divisor, units, kind }
+
+const ChannelInfo channelMap[kNumChannels] = {
+    CHANNEL("Thy:HeaterVoltage",       ThyHeaterVoltage,        "V",      kAnalog),
+    CHANNEL("Thy:ReservoirVoltage",    ThyReservoirVoltage,     "V",      kAnalog),
+    CHANNEL("Thy:TotalCurrent",        ThyTotalCurrent,         "A",      kAnalog),
+    CHANNEL("Thy:TimerPreheatMin",     ThyTimerPreheatMin,      "min",    kInteger),
+    CHANNEL("Thy:TimerPreheatSec",     ThyTimerPreheatSec,      "s",      kInteger),
+    CHANNEL("Thy:InterlockRaw",        ThyInterlock,            "",       kBits),
+    CHANNEL("Thy:StatusRaw",           ThyStatus,               "",       kBits),
+    CHANNEL("Klys:HeaterVoltage",      KlysHeaterVoltage,       "V",      kAnalog),
+    CHANNEL("Klys:HeaterCurrent",      KlysHeaterCurrent,       "A",      kAnalog),
+    CHANNEL("Klys:BodyWaterInTemp",    KlysBodyWaterInTemp,     "C",      kAnalog),
+    CHANNEL("Klys:BodyWaterOutTemp",   KlysBodyWaterOutTemp,    "C",      kAnalog),
+    CHANNEL("Klys:BodyWaterFlow",      KlysBodyWaterFlow,       "L/Hour", kAnalog),
+    CHANNEL("Klys:DissipatedPower",    KlysDissipatedPower,     "kW",     kAnalog),
+    CHANNEL("Klys:OilTemp",            KlysOilTemp,             "C",      kAnalog),
+    CHANNEL("Klys:TimerPreheat100Min", KlysTimerPreheat100Min,  "min",    kInteger),
+    CHANNEL("Klys:InterlockRaw",       KlysInterlock,           "",       kBits),
+    CHANNEL("Klys:StatusRaw",          KlysStatus,              "",       kBits),
+    CHANNEL("Focus:Coil1Voltage",      FocusCoil1Voltage,       "V",      kAnalog),
+    CHANNEL("Focus:Coil1Current",      FocusCoil1Current,       "A",      kAnalog),
+    CHANNEL("Focus:Coil2Voltage",      FocusCoil2Voltage,       "V",      kAnalog),
+    CHANNEL("Focus:Coil2Current",      FocusCoil2Current,       "A",      kAnalog),
+    CHANNEL("Focus:Coil3Voltage",      FocusCoil3Voltage,       "V",      kAnalog),
+    CHANNEL("Focus:Coil3Current",      FocusCoil3Current,       "A",      kAnalog),
+    CHANNEL("Focus:InterlockRaw",      FocusInterlock,          "",       kBits),
+    CHANNEL("Focus:StatusRaw",         FocusStatus,             "",       kBits),
+    CHANNEL("Premag:Voltage",          PremagVoltage,           "V",      kAnalog),
+    CHANNEL("Premag:Current",          PremagCurrent,           "A",      kAnalog),
+    CHANNEL("Premag:InterlockRaw",     PremagInterlock,         "",       kBits),
+    CHANNEL("Premag:StatusRaw",        PremagStatus,            "",       kBits),
+    CHANNEL("Waveguide:InterlockRaw",  WaveguideInterlock,      "",       kBits),
+    CHANNEL("VSWR:InterlockRaw",       VSWRInterlock,           "",       kBits),
+    CHANNEL("Clipper:InterlockRaw",    ClipperInterlock,        "",       kBits),
+    CHANNEL("Counter",                 Counter,                 "",       kAnalog),
+    CHANNEL("HVPS:ChargingVoltageRaw", HVPSChargingVoltage,     "",       kAnalog),
+    CHANNEL("HVPS:WaterTemperature",   HVPSWaterTemperature,    "C",      kAnalog),
+    CHANNEL("HVPS:InterlockRaw",       HVPSInterlock,           "",       kBits),
+    CHANNEL("HVPS:StatusRaw",          HVPSStatus,              "",       kBits),
+    CHANNEL("General:InterlockRaw",    GeneralInterlock,        "",       kBits),
+    CHANNEL("General:StatusRaw",       GeneralStatus,           "",       kBits),
+};
+
+#undef CHANNEL
+
+const BitInfo bitMap[] = {
+    /* Thyratron interlock (WORD5, byte 10) */
+    {  5,  0, "Thy:Interlock:HeaterVoltageHigh",        kMajorInterlock },
+    {  5,  1, "Thy:Interlock:HeaterVoltageLow",         kMajorInterlock },
+    {  5,  2, "Thy:Interlock:ReservoirVoltageHigh",     kMajorInterlock },
+    {  5,  3, "Thy:Interlock:ReservoirVoltageLow",      kMajorInterlock },
+    {  5,  4, "Thy:Interlock:TotalCurrentHigh",         kMajorInterlock },
+    {  5,  5, "Thy:Interlock:TotalCurrentLow",          kMajorInterlock },
+    {  5,  6, "Thy:Interlock:TempSwitch",               kMajorInterlock },
+    /* Thyratron status (WORD6, byte 12) */
+    {  6,  0, "Thy:Status:Ready",                       kStatusBit },
+    {  6,  1, "Thy:Status:ContactsOn",                  kStatusBit },
+    {  6,  2, "Thy:Status:PreheatingRunning",           kStatusBit },
+    /* Klystron interlock (WORD16, bytes 32-33) */
+    { 16,  0, "Klys:Interlock:HeaterVoltageHigh",       kMajorInterlock },
+    { 16,  1, "Klys:Interlock:HeaterVoltageLow",        kMajorInterlock },
+    { 16,  2, "Klys:Interlock:HeaterCurrentHigh",       kMajorInterlock },
+    { 16,  3, "Klys:Interlock:HeaterCurrentLow",        kMajorInterlock },
+    { 16,  4, "Klys:Interlock:PreheatingError",         kMajorInterlock },
+    { 16,  5, "Klys:Interlock:VacuumWarning",           kMinorInterlock },
+    { 16,  6, "Klys:Interlock:TankOilLevel",            kMajorInterlock },
+    { 16,  7, "Klys:Interlock:DissipatedPowerError",    kMajorInterlock },
+    { 16,  8, "Klys:Interlock:TankTemperature",         kMajorInterlock },
+    { 16,  9, "Klys:Interlock:BodyWaterFlow",           kMajorInterlock },
+    { 16, 10, "Klys:Interlock:CollectorWater",          kMajorInterlock },
+    { 16, 11, "Klys:Interlock:MaxPulseVoltage",         kMajorInterlock },
+    { 16, 12, "Klys:Interlock:MaxPulseCurrent",         kMajorInterlock },
+    { 16, 13, "Klys:Interlock:VacuumAlarm",             kMajorInterlock },
+    { 16, 14, "Klys:Interlock:BodyWaterInTemp",         kMajorInterlock },
+    { 16, 15, "Klys:Interlock:BodyWaterOutTemp",        kMajorInterlock },
+    /* Klystron status (WORD17, byte 34) */
+    { 17,  0, "Klys:Status:Ready",                      kStatusBit },
+    { 17,  1, "Klys:Status:OnOff",                      kStatusBit },
+    { 17,  2, "Klys:Status:Timer100Running",            kStatusBit },
+    { 17,  3, "Klys:Status:HeaterVoltage80Percent",     kStatusBit },
+    { 17,  4, "Klys:Status:HeaterVoltage100Percent",    kStatusBit },
+    /* Focus magnet interlock (WORD24, bytes 48-49) */
+    { 24,  0, "Focus:Interlock:Coil1VoltageHigh",       kMajorInterlock },
+    { 24,  1, "Focus:Interlock:Coil1VoltageLow",        kMajorInterlock },
+    { 24,  2, "Focus:Interlock:Coil1CurrentHigh",       kMajorInterlock },
+    { 24,  3, "Focus:Interlock:Coil1CurrentLow",        kMajorInterlock },
+    { 24,  4, "Focus:Interlock:Coil2VoltageHigh",       kMajorInterlock },
+    { 24,  5, "Focus:Interlock:Coil2VoltageLow",        kMajorInterlock },
+    { 24,  6, "Focus:Interlock:Coil2CurrentHigh",       kMajorInterlock },
+    { 24,  7, "Focus:Interlock:Coil2CurrentLow",        kMajorInterlock },
+    { 24,  8, "Focus:Interlock:Coil3VoltageHigh",       kMajorInterlock },
+    { 24,  9, "Focus:Interlock:Coil3VoltageLow",        kMajorInterlock },
+    { 24, 10, "Focus:Interlock:Coil3CurrentHigh",       kMajorInterlock },
+    { 24, 11, "Focus:Interlock:Coil3CurrentLow",        kMajorInterlock },
+    { 24, 12, "Focus:Interlock:WaterFlowAlarm",         kMajorInterlock },
+    { 24, 13, "Focus:Interlock:TemperatureAlarm",       kMajorInterlock },
+    { 24, 14, "Focus:Interlock:ShortCircuitGround",     kMajorInterlock },
+    /* Focus magnet status (WORD25, byte 50) */
+    { 25,  0, "Focus:Status:Ready",                     kStatusBit },
+    { 25,  1, "Focus:Status:OnOff",                     kStatusBit },
+    /* Premagnetisation interlock (WORD28, byte 56) */
+    { 28,  0, "Premag:Interlock:VoltageHigh",           kMajorInterlock },
+    { 28,  1, "Premag:Interlock:VoltageLow",            kMajorInterlock },
+    { 28,  2, "Premag:Interlock:CurrentHigh",           kMajorInterlock },
+    { 28,  3, "Premag:Interlock:CurrentLow",            kMajorInterlock },
+    { 28,  7, "Premag:Interlock:HVCableNotConnected",   kMajorInterlock },
+    /* Premagnetisation status (WORD29, byte 58) */
+    { 29,  0, "Premag:Status:Ready",                    kStatusBit },
+    { 29,  1, "Premag:Status:OnOff",                    kStatusBit },
+    /* Vacuum/VSWR interlock (WORD30, bytes 60-61) */
+    { 30,  0, "Waveguide:Interlock:Vacuum1",            kMajorInterlock },
+    { 30,  1, "Waveguide:Interlock:Vacuum2",            kMajorInterlock },
+    { 30,  2, "Waveguide:Interlock:Vacuum3",            kMajorInterlock },
+    { 30,  3, "Waveguide:Interlock:Vacuum4",            kMajorInterlock },
+    { 30,  4, "Waveguide:Interlock:Vacuum5",            kMajorInterlock },
+    { 30,  5, "Waveguide:Interlock:Vacuum6",            kMajorInterlock },
+    { 30,  6, "Waveguide:Interlock:Vacuum7",            kMajorInterlock },
+    { 30,  7, "Waveguide:Interlock:Vacuum8",            kMajorInterlock },
+    { 30,  8, "Waveguide:Interlock:VSWR1",              kMajorInterlock },
+    { 30,  9, "Waveguide:Interlock:VSWR2",              kMajorInterlock },
+    { 30, 12, "Waveguide:Interlock:VacuumAcc1",         kMajorInterlock },
+    { 30, 13, "Waveguide:Interlock:VacuumAcc2",         kMajorInterlock },
+    { 30, 14, "Waveguide:Interlock:WaterAcc1",          kMajorInterlock },
+    { 30, 15, "Waveguide:Interlock:WaterAcc2",          kMajorInterlock },
+    /* External interlocks (WORD31, byte 62) */
+    { 31,  0, "VSWR:Interlock:Ext1A",                   kMajorInterlock },
+    { 31,  1, "VSWR:Interlock:Ext1B",                   kMajorInterlock },
+    { 31,  2, "VSWR:Interlock:Ext2A",                   kMajorInterlock },
+    { 31,  3, "VSWR:Interlock:Ext2B",                   kMajorInterlock },
+    { 31,  4, "VSWR:Interlock:Ext3A",                   kMajorInterlock },
+    { 31,  5, "VSWR:Interlock:Ext3B",                   kMajorInterlock },
+    { 31,  6, "VSWR:Interlock:Ext4A",                   kMajorInterlock },
+    { 31,  7, "VSWR:Interlock:Ext4B",                   kMajorInterlock },
+    /* End of line clipper (WORD32, byte 64) */
+    { 32,  0, "Clipper:Interlock:Clipper1",             kMajorInterlock },
+    { 32,  1, "Clipper:Interlock:Clipper2",             kMajorInterlock },
+    { 32,  2, "Clipper:Interlock:Error",                kMajorInterlock },
+    /* HVPS interlock (WORD36, byte 72) */
+    { 36,  0, "HVPS:Interlock:Internal",                kMajorInterlock },
+    { 36,  1, "HVPS:Interlock:Line",                    kMajorInterlock },
+    { 36,  2, "HVPS:Interlock:Overload",                kMajorInterlock },
+    { 36,  3, "HVPS:Interlock:Temperature",             kMajorInterlock },
+    { 36,  4, "HVPS:Interlock:WaterTempError",          kMajorInterlock },
+    { 36,  5, "HVPS:Interlock:OvervoltageProt",         kMajorInterlock },
+    { 36,  6, "HVPS:Interlock:WaterFlow",               kMajorInterlock },
+    { 36,  7, "HVPS:Interlock:MaxVoltageReached",       kMajorInterlock },
+    /* HVPS status (WORD37, byte 74) */
+    { 37,  0, "HVPS:Status:OnOff",                      kStatusBit },
+    { 37,  1, "HVPS:Status:Ready",                      kStatusBit },
+    { 37,  2, "HVPS:Status:HighVoltageOnOff",           kStatusBit },
+    /* Cabinets and safety systems interlock (WORD38, bytes 76-77) */
+    { 38,  0, "General:Interlock:GroundSwitches",       kMajorInterlock },
+    { 38,  1, "General:Interlock:DoorsPFN",             kMajorInterlock },
+    { 38,  2, "General:Interlock:GroundRods",           kMajorInterlock },
+    { 38,  3, "General:Interlock:PersonnelSafety1",     kMajorInterlock },
+    { 38,  4, "General:Interlock:PersonnelSafety2",     kMajorInterlock },
+    { 38,  5, "General:Interlock:CoolingUnit1",         kMajorInterlock },
+    { 38,  6, "General:Interlock:CoolingUnit2",         kMajorInterlock },
+    { 38,  7, "General:Interlock:MainContactor",        kMajorInterlock },
+    { 38,  8, "General:Interlock:EmergencyOff",         kMajorInterlock },
+    { 38,  9, "General:Interlock:CircuitBreaker",       kMajorInterlock },
+    { 38, 10, "General:Interlock:SmokeDetection",       kMajorInterlock },
+    /* Cabinets and safety systems status (WORD39, bytes 78-79) */
+    { 39,  0, "General:Status:LocalRemote",             kStatusBit },
+    { 39,  1, "General:Status:CabinetDoors",            kStatusBit },
+    { 39,  2, "General:Status:EmergencyOffSystem",      kStatusBit },
+    { 39,  3, "General:Status:MainContactor",           kStatusBit },
+    { 39,  4, "General:Status:SignalLightGreen",        kStatusBit },
+    { 39,  5, "General:Status:SignalLightYellow",       kStatusBit },
+    { 39,  6, "General:Status:SignalLightRed",          kStatusBit },
+    { 39,  7, "General:Status:GroundRods",              kStatusBit },
+    { 39,  8, "General:Status:GroundSwitches",          kStatusBit },
+    { 39,  9, "General:Status:PersonnelSafety1",        kStatusBit },
+    { 39, 10, "General:Status:PersonnelSafety2",        kStatusBit },
+};
+
+const size_t numBits = sizeof(bitMap) / sizeof(bitMap[0]);
+
+const CommandInfo commandMap[kNumCommands] = {
+    { "Thy:OnCmd",        0 },
+    { "Klys:On80Cmd",     1 },
+    { "Klys:On100Cmd",    2 },
+    { "Focus:OnCmd",      3 },
+    { "Premag:OnCmd",     4 },
+    { "HVPS:OnCmd",       5 },
+    { "ChargePFN:OnCmd",  6 },
+    { "Reset:Cmd",        7 },
+    { "Thy:OffCmd",       8 },
+    { "Klys:Off80Cmd",    9 },
+    { "Klys:Off100Cmd",  10 },
+    { "Focus:OffCmd",    11 },
+    { "Premag:OffCmd",   12 },
+    { "HVPS:OffCmd",     13 },
+    { "ChargePFN:OffCmd", 14 },
+    { "Reset:OffCmd",    15 },
+};
+
+int validateFrame(FrameView frame, uint8_t *quality)
+{
+    int failed = 0;
+
+    for (int w = 0; w < kFrameWords; w++) {
+        const WordInfo &desc = wordMap[w];
+        uint16_t raw = frame.word(w);
+        unsigned rangeBad = raw > desc.maxValue;
+        unsigned maskBad = (raw & (uint16_t)~desc.bitMask) != 0;
+
+        quality[w] = (uint8_t)(rangeBad * kQualRange | maskBad * kQualMask);
+        failed += rangeBad + maskBad;
+    }
+    return failed;
+}
+
+void decodeFrame(FrameView frame, DecodedFrame &out)
+{
+    for (int w = 0; w < kFrameWords; w++)
+        out.words[w] = frame.word(w);
+    out.failed = validateFrame(frame, out.quality);
+    for (int c = 0; c < kNumChannels; c++)
+        out.values[c] = out.words[channelMap[c].word] / channelMap[c].scale;
+}
+
+double channelValue(FrameView frame, int channel, const uint8_t *quality)
+{
+    const ChannelInfo &ch = channelMap[channel];
+    uint16_t raw = frame.word(ch.word);
+
+    if (ch.kind == kAnalog)
+        return quality[ch.word] ? std::numeric_limits<double>::quiet_NaN()
+                                : raw / ch.scale;
+    return quality[ch.word] ? raw + kInvalidFlag : (double)raw;
+}
+
+int trackChanges(FrameView frame, uint16_t *words, uint32_t *changes,
+                 double *lastChange, double now, bool primed)
+{
+    unsigned mask = primed ? 1 : 0;
+    int changed = 0;
+
+    /* Branch-free compare, the stamp store is a conditional move */
+    for (int w = 0; w < kFrameWords; w++) {
+        uint16_t raw = frame.word(w);
+        unsigned diff = mask & (raw != words[w]);
+
+        changes[w] += diff;
+        lastChange[w] = diff ? now : lastChange[w];
+        words[w] = raw;
+        changed += diff;
+    }
+    return changed;
+}
+
+size_t encodeCommand32(uint32_t image, uint8_t *out)
+{
+    out[0] = (uint8_t)(image & 0xFF);
+    out[1] = (uint8_t)((image >> 8) & 0xFF);
+    out[2] = (uint8_t)((image >> 16) & 0xFF);
+    out[3] = (uint8_t)((image >> 24) & 0xFF);
+    out[4] = 0xFF;
+    out[5] = 0xFF;
+    return kCmd32Bytes;
+}
+
+} // namespace ppt
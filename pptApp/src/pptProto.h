@@ -0,0 +1,161 @@
+/*
+ * pptProto.h
+ *
+ * libpptproto - dependency-free description of the PPT Modulator
+ * (IF-MOD2128C Rev 2.1) TCP/IP protocol
+ *
+ * - Frame layout: 86 bytes = 43 words, see FrameView (pptFrameView.h)
+ * - Register map: documented value range and used bits of every word
+ * - Decoder: 39 scaled channels with per-word quality flags
+ * - Bit tables: names of all status and interlock bits
+ * - Command encoder: writeFullCmd32 wire format (ppt.proto)
+ *
+ * Used by the IOC (pptsup) and by command-line tools such as pptcat.
+ * Only the C++ standard library may be used here.
+ */
+
+#ifndef PPTPROTO_H
+#define PPTPROTO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pptFrameView.h"
+
+namespace ppt {
+
+/* Per-word data-quality flags */
+const uint8_t kQualRange = 0x01;    /* raw value above the documented range */
+const uint8_t kQualMask  = 0x02;    /* bit set that the register map leaves unused */
+
+/* Register map entry of one 16-bit word */
+struct WordInfo {
+    const char *name;
+    uint16_t maxValue;      /* highest documented raw value */
+    uint16_t bitMask;       /* bits defined by the register map */
+};
+
+extern const WordInfo wordMap[kFrameWords];
+
+/*
+ * Check all words against wordMap in a single branch-free pass.
+ * Fills quality[kFrameWords] and returns the number of failed checks.
+ */
+int validateFrame(FrameView frame, uint8_t *quality);
+
+/* Decoded channels, in the order of channelMap */
+enum ChannelKind {
+    kAnalog,        /* scaled measurement */
+    kInteger,       /* timer or counter */
+    kBits           /* raw status/interlock word */
+};
+
+struct ChannelInfo {
+    const char *name;       /* PV suffix after $(P):$(R): */
+    int word;
+    double scale;           /* engineering value = raw / scale */
+    const char *units;
+    ChannelKind kind;
+};
+
+enum Channel {
+    ThyHeaterVoltage, ThyReservoirVoltage, ThyTotalCurrent,
+    ThyTimerPreheatMin, ThyTimerPreheatSec, ThyInterlockRaw, ThyStatusRaw,
+    KlysHeaterVoltage, KlysHeaterCurrent, KlysBodyWaterInTemp,
+    KlysBodyWaterOutTemp, KlysBodyWaterFlow, KlysDissipatedPower,
+    KlysOilTemp, KlysTimerPreheat100Min, KlysInterlockRaw, KlysStatusRaw,
+    FocusCoil1Voltage, FocusCoil1Current, FocusCoil2Voltage,
+    FocusCoil2Current, FocusCoil3Voltage, FocusCoil3Current,
+    FocusInterlockRaw, FocusStatusRaw,
+    PremagVoltage, PremagCurrent, PremagInterlockRaw, PremagStatusRaw,
+    WaveguideInterlockRaw, VSWRInterlockRaw, ClipperInterlockRaw, Counter,
+    HVPSChargingVoltageRaw, HVPSWaterTemperature, HVPSInterlockRaw,
+    HVPSStatusRaw, GeneralInterlockRaw, GeneralStatusRaw,
+    kNumChannels
+};
+
+extern const ChannelInfo channelMap[kNumChannels];
+
+/* One decoded frame */
+struct DecodedFrame {
+    uint16_t words[kFrameWords];
+    uint8_t quality[kFrameWords];
+    double values[kNumChannels];    /* raw / scale, also for invalid words */
+    int failed;                     /* failed checks, see validateFrame */
+};
+
+/* Validate and decode a frame */
+void decodeFrame(FrameView frame, DecodedFrame &out);
+
+inline bool channelValid(const DecodedFrame &frame, int channel)
+{
+    return frame.quality[channelMap[channel].word] == 0;
+}
+
+/*
+ * Channel value as published by the IOC: raw / scale, or for a word that
+ * failed validation NaN (analog) and raw + kInvalidFlag (timer/bitfield,
+ * bit 16 above the word trips the HIHI=65536 INVALID limit of a longin).
+ */
+const double kInvalidFlag = 65536.0;
+
+double channelValue(FrameView frame, int channel, const uint8_t *quality);
+
+/*
+ * Per-word change statistics: counts the words that differ from
+ * words[kFrameWords] (only when primed), stamps them with now and stores
+ * the new words. Returns the number of changed words.
+ */
+int trackChanges(FrameView frame, uint16_t *words, uint32_t *changes,
+                 double *lastChange, double now, bool primed);
+
+/* Named status and interlock bits */
+enum BitSeverity {
+    kStatusBit,
+    kMinorInterlock,
+    kMajorInterlock
+};
+
+struct BitInfo {
+    int word;
+    int bit;
+    const char *name;       /* PV suffix after $(P):$(R): */
+    BitSeverity severity;
+};
+
+extern const BitInfo bitMap[];
+extern const size_t numBits;
+
+/* Remote control commands: bits 0-15 of the command register */
+struct CommandInfo {
+    const char *name;       /* PV suffix of the command record */
+    int bit;
+};
+
+enum Command {
+    ThyOn, KlysOn80, KlysOn100, FocusOn, PremagOn, HVPSOn, ChargePFNOn, ResetOn,
+    ThyOff, KlysOff80, KlysOff100, FocusOff, PremagOff, HVPSOff, ChargePFNOff,
+    ResetOff,
+    kNumCommands
+};
+
+extern const CommandInfo commandMap[kNumCommands];
+
+const int kCmd32Bytes = 6;
+const uint16_t kHVMaxRaw = 500;     /* 50.0 kV */
+
+/* 32-bit command register image: (HV << 16) | ON/OFF bits */
+inline uint32_t commandImage(uint16_t onOffBits, uint16_t hvRaw)
+{
+    return ((uint32_t)hvRaw << 16) | onOffBits;
+}
+
+/*
+ * writeFullCmd32 wire format: 32-bit image little-endian followed by
+ * 0xFF 0xFF. Fills out[kCmd32Bytes] and returns kCmd32Bytes.
+ */
+size_t encodeCommand32(uint32_t image, uint8_t *out);
+
+} // namespace ppt
+
+#endif /* PPTPROTO_H */
@@ -0,0 +1,149 @@
+/*
+ * pptRamp.cpp
+ *
+ * HVPS setpoint ramp, see pptRamp.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pptRamp.h"
+
+namespace ppt {
+
+void rampInterlockMasks(uint16_t masks[kFrameWords])
+{
+    static const char *prefixes[] = {
+        "Waveguide:Interlock:VSWR", "VSWR:Interlock:", "Clipper:Interlock:", "HVPS:Interlock:"
+    };
+
+    memset(masks, 0, kFrameWords * sizeof(masks[0]));
+    for (size_t n = 0; n < numBits; n++) {
+        const BitInfo &info = bitMap[n];
+
+        if (info.severity == kStatusBit)
+            continue;
+        for (size_t p = 0; p < sizeof(prefixes) / sizeof(prefixes[0]); p++)
+            if (strncmp(info.name, prefixes[p], strlen(prefixes[p])) == 0)
+                masks[info.word] |= (uint16_t)(1u << info.bit);
+    }
+}
+
+HVRamp::HVRamp()
+    : state_(kRampIdle), reason_(""), from_(0), target_(0), setpoint_(0), confirmed_(true),
+      stepTime_(0.0)
+{
+    config_.rate = 0.1;
+    config_.step = 1;
+    config_.tolerance = 5;
+    config_.confirmTimeout = 10.0;
+    config_.stepBack = 0;
+}
+
+bool HVRamp::start(uint16_t setpoint, uint16_t target, double now)
+{
+    if (!(config_.rate > 0.0))
+        return false;
+    state_ = kRampRunning;
+    reason_ = "";
+    from_ = setpoint;
+    target_ = target;
+    setpoint_ = setpoint;
+    /* The present setpoint needs no confirmation: the first step is due */
+    confirmed_ = true;
+    stepTime_ = now - 1e9;
+    return true;
+}
+
+void HVRamp::pause(const char *reason)
+{
+    if (state_ != kRampRunning)
+        return;
+    state_ = kRampPaused;
+    reason_ = reason;
+}
+
+bool HVRamp::resume(double now)
+{
+    if (state_ != kRampPaused)
+        return false;
+    /* The voltage may be down after a trip: continue from the setpoint */
+    state_ = kRampRunning;
+    reason_ = "";
+    confirmed_ = true;
+    stepTime_ = now;
+    return true;
+}
+
+void HVRamp::stop(const char *reason)
+{
+    if (!active())
+        return;
+    state_ = kRampStopped;
+    reason_ = reason;
+}
+
+bool HVRamp::update(int measured, bool tripped, double now, uint16_t &setpoint)
+{
+    uint16_t step = config_.step ? config_.step : 1;
+    int distance;
+
+    if (state_ != kRampRunning)
+        return false;
+
+    if (tripped) {
+        int back = config_.stepBack;
+        int toStart = abs((int)setpoint_ - (int)from_);
+
+        pause("interlock");
+        if (!back)
+            return false;
+        if (back > toStart)
+            back = toStart;
+        setpoint_ = (uint16_t)(target_ >= from_ ? setpoint_ - back : setpoint_ + back);
+        setpoint = setpoint_;
+        return back > 0;
+    }
+
+    if (!confirmed_) {
+        if (measured >= 0 && abs(measured - (int)setpoint_) <= config_.tolerance) {
+            confirmed_ = true;
+        } else {
+            if (now - stepTime_ > config_.confirmTimeout)
+                pause("no confirmation");
+            return false;
+        }
+    }
+
+    distance = (int)target_ - (int)setpoint_;
+    if (distance == 0) {
+        state_ = kRampDone;
+        return false;
+    }
+    if (now - stepTime_ < step / (config_.rate * 10.0))
+        return false;
+
+    if (abs(distance) < step)
+        step = (uint16_t)abs(distance);
+    setpoint_ = (uint16_t)(distance > 0 ? setpoint_ + step : setpoint_ - step);
+    confirmed_ = false;
+    stepTime_ = now;
+    setpoint = setpoint_;
+    return true;
+}
+
+double HVRamp::progress() const
+{
+    if (target_ == from_)
+        return state_ == kRampIdle ? 0.0 : 100.0;
+    return 100.0 * ((int)setpoint_ - (int)from_) / ((int)target_ - (int)from_);
+}
+
+double HVRamp::eta() const
+{
+    if (state_ != kRampRunning || !(config_.rate > 0.0))
+        return 0.0;
+    return abs((int)target_ - (int)setpoint_) / (config_.rate * 10.0);
+}
+
+} // namespace ppt
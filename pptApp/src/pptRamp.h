@@ -0,0 +1,85 @@
+/*
+ * pptRamp.h
+ *
+ * Ramp of the HVPS charging voltage setpoint (pptDriver)
+ *
+ * The setpoint moves from its value at start to the target in steps of a
+ * multiple of the 0.1 kV wire resolution, at most rate kV/s. A step is
+ * written only when the previous one is confirmed: the measured charging
+ * voltage (frame word HVPS:ChargingVoltageRaw, 0.1 kV) within tolerance
+ * of the setpoint. Without confirmation within confirmTimeout the ramp
+ * pauses, as it does when a VSWR, clipper or HVPS interlock bit trips;
+ * then the setpoint also steps back by stepBack towards the start. A
+ * paused ramp continues with resume() from its current setpoint.
+ *
+ * Setpoints are raw, 0.1 kV units like the command register.
+ *
+ * The interlock bits that trip a ramp are those of bitMap named in
+ * rampInterlockMasks(): the waveguide VSWR bits (word 30 bits 8-9), the
+ * external interlocks of the VSWR word (word 31), the clipper (word 32)
+ * and the HVPS interlocks (word 36).
+ */
+
+#ifndef PPTRAMP_H
+#define PPTRAMP_H
+
+#include <stdint.h>
+
+#include "pptProto.h"
+
+namespace ppt {
+
+/* Per frame word the bits of the interlocks that trip a ramp */
+void rampInterlockMasks(uint16_t masks[kFrameWords]);
+
+enum RampState { kRampIdle, kRampRunning, kRampPaused, kRampDone, kRampStopped };
+
+struct RampConfig {
+    double rate;                /* kV/s */
+    uint16_t step;              /* raw, >= 1 */
+    uint16_t tolerance;         /* raw */
+    double confirmTimeout;      /* s */
+    uint16_t stepBack;          /* raw, 0: only pause */
+};
+
+class HVRamp {
+public:
+    HVRamp();
+
+    RampConfig &config() { return config_; }
+
+    /* Ramp from setpoint to target; false (and no change) if rate is not > 0 */
+    bool start(uint16_t setpoint, uint16_t target, double now);
+    void pause(const char *reason);
+    bool resume(double now);
+    void stop(const char *reason);
+
+    /*
+     * Per frame: measured charging voltage (raw, -1 if invalid) and
+     * whether a VSWR/clipper/HVPS interlock bit is set. True with the
+     * setpoint to write when the ramp takes a step (or steps back).
+     */
+    bool update(int measured, bool tripped, double now, uint16_t &setpoint);
+
+    RampState state() const { return state_; }
+    bool active() const { return state_ == kRampRunning || state_ == kRampPaused; }
+    const char *reason() const { return reason_; }
+    uint16_t setpoint() const { return setpoint_; }
+    uint16_t target() const { return target_; }
+    double progress() const;            /* % of the way from start to target */
+    double eta() const;                 /* s at the configured rate, 0 unless running */
+
+private:
+    RampConfig config_;
+    RampState state_;
+    const char *reason_;
+    uint16_t from_;
+    uint16_t target_;
+    uint16_t setpoint_;
+    bool confirmed_;            /* measured voltage reached setpoint_ */
+    double stepTime_;           /* time setpoint_ was written */
+};
+
+} // namespace ppt
+
+#endif /* PPTRAMP_H */
@@ -0,0 +1,133 @@
+/*
+ * pptSoe.cpp
+ *
+ * Sequence-of-events recorder, see pptSoe.h
+ */
+
+#include <string.h>
+
+#include "pptSoe.h"
+#include "pptProto.h"
+
+namespace ppt {
+
+namespace {
+
+/* Per frame word: bitMap bits, interlock bits and bitMap index per bit */
+struct SoeTables {
+    uint16_t named[kFrameWords];
+    uint16_t interlock[kFrameWords];
+    uint16_t index[kFrameWords][16];
+
+    SoeTables() {
+        memset(this, 0, sizeof(*this));
+        for (size_t n = 0; n < numBits; n++) {
+            const BitInfo &info = bitMap[n];
+            uint16_t bit = (uint16_t)(1u << info.bit);
+
+            named[info.word] |= bit;
+            if (info.severity != kStatusBit)
+                interlock[info.word] |= bit;
+            index[info.word][info.bit] = (uint16_t)n;
+        }
+    }
+};
+
+const SoeTables &tables()
+{
+    static const SoeTables t;
+    return t;
+}
+
+} // namespace
+
+SoeRecorder::SoeRecorder(size_t capacity)
+    : events_(capacity ? capacity : 1), head_(0), count_(0), total_(0),
+      primed_(false), tripped_(false), trips_(0), numFirstFaults_(0)
+{
+    memset(words_, 0, sizeof(words_));
+}
+
+void SoeRecorder::reset()
+{
+    primed_ = false;
+}
+
+void SoeRecorder::clear()
+{
+    head_ = 0;
+    count_ = 0;
+}
+
+const SoeEvent &SoeRecorder::at(size_t i) const
+{
+    size_t n = events_.size();
+    return events_[(head_ + n - count_ + i) % n];
+}
+
+void SoeRecorder::record(const SoeEvent &event)
+{
+    events_[head_] = event;
+    head_ = (head_ + 1) % events_.size();
+    if (count_ < events_.size())
+        count_++;
+    total_++;
+}
+
+int SoeRecorder::update(FrameView frame, const uint8_t *quality, double time, uint32_t frameNumber)
+{
+    const SoeTables &t = tables();
+    uint16_t words[kFrameWords];
+    bool tripped = false;
+    int edges = 0;
+
+    for (int w = 0; w < kFrameWords; w++) {
+        words[w] = words_[w];
+        if (!t.named[w] || (primed_ && quality && quality[w]))
+            continue;
+        words[w] = frame.word(w) & t.named[w];
+    }
+    for (int w = 0; w < kFrameWords; w++)
+        tripped |= (words[w] & t.interlock[w]) != 0;
+
+    if (!primed_) {
+        memcpy(words_, words, sizeof(words_));
+        primed_ = true;
+        tripped_ = tripped;
+        return 0;
+    }
+
+    bool newTrip = tripped && !tripped_;
+    if (newTrip) {
+        trips_++;
+        numFirstFaults_ = 0;
+    }
+
+    SoeEvent event;
+    event.time = time;
+    event.frame = frameNumber;
+    event.trip = (tripped || tripped_) ? trips_ : 0;
+    for (int w = 0; w < kFrameWords; w++) {
+        uint16_t diff = words[w] ^ words_[w];
+
+        for (int b = 0; diff; b++, diff >>= 1) {
+            if (!(diff & 1))
+                continue;
+            uint16_t bit = (uint16_t)(1u << b);
+
+            event.bit = t.index[w][b];
+            event.rising = (words[w] & bit) != 0;
+            event.firstFault = newTrip && event.rising && (t.interlock[w] & bit);
+            if (event.firstFault && numFirstFaults_ < kMaxFirstFaults)
+                firstFaults_[numFirstFaults_++] = event.bit;
+            record(event);
+            edges++;
+        }
+    }
+
+    memcpy(words_, words, sizeof(words_));
+    tripped_ = tripped;
+    return edges;
+}
+
+} // namespace ppt
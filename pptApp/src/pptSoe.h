@@ -0,0 +1,87 @@
+/*
+ * pptSoe.h
+ *
+ * Sequence-of-events recorder
+ *
+ * Compares the status and interlock words of consecutive frames and
+ * records every edge of a bitMap bit with the receive time of its frame
+ * in a circular buffer allocated once. A trip starts with the first frame
+ * in which an interlock bit is set while none was; the interlock bits set
+ * in that frame are its first faults. Edges up to the frame in which all
+ * interlock bits are clear again carry the trip number.
+ *
+ * Words that fail validation are held at their last valid value, so a
+ * corrupted word does not produce edges.
+ */
+
+#ifndef PPTSOE_H
+#define PPTSOE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "pptFrameView.h"
+
+namespace ppt {
+
+struct SoeEvent {
+    double time;            /* frame receive time, POSIX seconds */
+    uint32_t frame;         /* frame number passed to update() */
+    uint32_t trip;          /* trip number, 0 outside a trip */
+    uint16_t bit;           /* bitMap index */
+    uint8_t rising;         /* 1 bit set, 0 bit cleared */
+    uint8_t firstFault;     /* interlock bit that started the trip */
+};
+
+class SoeRecorder {
+public:
+    explicit SoeRecorder(size_t capacity = 512);
+
+    /*
+     * Compare frame with the previous one and record its edges; quality
+     * (kFrameWords flags from validateFrame, may be NULL) marks words to
+     * hold. Returns the number of edges recorded.
+     */
+    int update(FrameView frame, const uint8_t *quality, double time, uint32_t frameNumber);
+
+    /* Forget the previous frame, e.g. after a reconnect: the next frame
+     * only sets the reference */
+    void reset();
+
+    /* Empty the buffer; trip numbering continues */
+    void clear();
+
+    size_t capacity() const { return events_.size(); }
+    size_t size() const { return count_; }
+    unsigned long total() const { return total_; }
+    uint32_t trips() const { return trips_; }
+    bool tripped() const { return tripped_; }
+
+    /* Event i, 0 = oldest still in the buffer */
+    const SoeEvent &at(size_t i) const;
+
+    /* bitMap indices of the first faults of the last trip */
+    int numFirstFaults() const { return numFirstFaults_; }
+    int firstFault(int i) const { return firstFaults_[i]; }
+
+private:
+    void record(const SoeEvent &event);
+
+    static const int kMaxFirstFaults = 16;
+
+    std::vector<SoeEvent> events_;
+    size_t head_;               /* next slot to write */
+    size_t count_;
+    unsigned long total_;
+    uint16_t words_[kFrameWords];
+    bool primed_;
+    bool tripped_;
+    uint32_t trips_;
+    int numFirstFaults_;
+    uint16_t firstFaults_[kMaxFirstFaults];
+};
+
+} // namespace ppt
+
+#endif /* PPTSOE_H */
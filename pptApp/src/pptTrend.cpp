@@ -0,0 +1,25 @@
+/*
+ * pptTrend.cpp
+ *
+ * Fixed-size trend buffer, see pptTrend.h
+ */
+
+#include "pptTrend.h"
+
+namespace ppt {
+
+TrendBuffer::TrendBuffer(size_t depth)
+    : buf_(2 * (depth ? depth : 1)), depth_(depth ? depth : 1), head_(0), count_(0)
+{
+}
+
+void TrendBuffer::push(double value)
+{
+    buf_[head_] = value;
+    buf_[head_ + depth_] = value;
+    head_ = (head_ + 1) % depth_;
+    if (count_ < depth_)
+        count_++;
+}
+
+} // namespace ppt
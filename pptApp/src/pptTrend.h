@@ -0,0 +1,47 @@
+/*
+ * pptTrend.h
+ *
+ * Fixed-size trend buffer of one channel
+ *
+ * The samples are stored twice, at i and i + depth, so the last size()
+ * samples are always one contiguous array, oldest first: data() can be
+ * handed to a waveform without copying or unrolling the ring.
+ */
+
+#ifndef PPTTREND_H
+#define PPTTREND_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace ppt {
+
+class TrendBuffer {
+public:
+    explicit TrendBuffer(size_t depth = 3600);
+
+    void push(double value);
+    void clear() { head_ = 0; count_ = 0; }
+
+    size_t depth() const { return depth_; }
+    size_t size() const { return count_; }
+
+    /* size() samples, oldest first */
+    const double *data() const { return &buf_[head_ + depth_ - count_]; }
+
+    /* The newest n samples (n <= size()) */
+    const double *latest(size_t n) const { return &buf_[head_ + depth_ - n]; }
+
+    /* Memory held by the buffer */
+    size_t bytes() const { return buf_.size() * sizeof(double); }
+
+private:
+    std::vector<double> buf_;
+    size_t depth_;
+    size_t head_;           /* next slot, 0 .. depth - 1 */
+    size_t count_;
+};
+
+} // namespace ppt
+
+#endif /* PPTTREND_H */
@@ -0,0 +1,249 @@
+/*
+ * pptcat.cpp
+ *
+ * Inspect a PPT Modulator without an IOC: connects to the modulator (or a
+ * simulator) on TCP port 2000, or reads a recording, and prints every
+ * decoded frame as it arrives.
+ *
+ * Output formats:
+ *   text  one line per frame: time, frame number, failed checks, channels
+ *   csv   header line with channel names, then one row per frame
+ *   bin   the raw 86-byte frames, back to back (a recording for -i)
+ *
+ * Examples:
+ *   pptcat 192.168.197.111
+ *   pptcat -f bin 192.168.197.111 > mod1.bin
+ *   pptcat -f csv -i mod1.bin
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <string>
+
+#include "pptProto.h"
+#include "pptFramer.h"
+
+namespace {
+
+enum Format { kText, kCsv, kBin };
+
+struct Options {
+    Format format;
+    long count;
+    bool bits;
+    int maxFailures;
+    const char *input;
+    std::string host;
+    std::string port;
+};
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [options] host[:port]\n"
+        "       %s [options] -i recording\n"
+        "  -i FILE   read a recording of raw frames ('-' for stdin)\n"
+        "  -f FMT    output format: text (default), csv, bin\n"
+        "  -n COUNT  exit after COUNT frames\n"
+        "  -b        text: list the status/interlock bits that are set\n"
+        "  -m N      realign when a frame fails more than N checks (default 4)\n"
+        "  -h        show this help\n",
+        prog, prog);
+}
+
+int connectTo(const std::string &host, const std::string &port)
+{
+    struct addrinfo hints, *res, *ai;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+    if (status != 0) {
+        fprintf(stderr, "pptcat: %s: %s\n", host.c_str(), gai_strerror(status));
+        return -1;
+    }
+    int fd = -1;
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0)
+        fprintf(stderr, "pptcat: cannot connect to %s:%s: %s\n",
+                host.c_str(), port.c_str(), strerror(errno));
+    return fd;
+}
+
+void formatTime(char *buf, size_t len)
+{
+    struct timeval tv;
+    struct tm tm;
+    gettimeofday(&tv, NULL);
+    localtime_r(&tv.tv_sec, &tm);
+    size_t n = strftime(buf, len, "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(buf + n, len - n, ".%03ld", (long)(tv.tv_usec / 1000));
+}
+
+void printCsvHeader()
+{
+    printf("time,frame,failed");
+    for (int c = 0; c < ppt::kNumChannels; c++)
+        printf(",%s", ppt::channelMap[c].name);
+    printf("\n");
+}
+
+void printFrame(const Options &opt, unsigned long number,
+                const ppt::FrameBuffer &raw, const ppt::DecodedFrame &frame)
+{
+    char stamp[40];
+
+    if (opt.format == kBin) {
+        fwrite(raw.bytes, 1, ppt::kFrameBytes, stdout);
+        fflush(stdout);
+        return;
+    }
+
+    formatTime(stamp, sizeof(stamp));
+    if (opt.format == kCsv) {
+        printf("%s,%lu,%d", stamp, number, frame.failed);
+        for (int c = 0; c < ppt::kNumChannels; c++)
+            printf(",%g", frame.values[c]);
+        printf("\n");
+        fflush(stdout);
+        return;
+    }
+
+    printf("%s #%lu failed=%d", stamp, number, frame.failed);
+    for (int c = 0; c < ppt::kNumChannels; c++) {
+        const ppt::ChannelInfo &ch = ppt::channelMap[c];
+        if (ch.kind == ppt::kBits)
+            printf(" %s=0x%04X", ch.name, frame.words[ch.word]);
+        else
+            printf(" %s=%g", ch.name, frame.values[c]);
+        if (!ppt::channelValid(frame, c))
+            printf("(INVALID)");
+    }
+    if (opt.bits) {
+        printf(" bits=");
+        const char *sep = "";
+        for (size_t i = 0; i < ppt::numBits; i++) {
+            const ppt::BitInfo &b = ppt::bitMap[i];
+            if (frame.words[b.word] & (1u << b.bit)) {
+                printf("%s%s", sep, b.name);
+                sep = ",";
+            }
+        }
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+bool parseArgs(int argc, char *argv[], Options &opt)
+{
+    int c;
+
+    opt.format = kText;
+    opt.count = -1;
+    opt.bits = false;
+    opt.maxFailures = 4;
+    opt.input = NULL;
+    opt.port = "2000";
+
+    while ((c = getopt(argc, argv, "i:f:n:bm:h")) != -1) {
+        switch (c) {
+        case 'i': opt.input = optarg; break;
+        case 'n': opt.count = atol(optarg); break;
+        case 'b': opt.bits = true; break;
+        case 'm': opt.maxFailures = atoi(optarg); break;
+        case 'f':
+            if (!strcmp(optarg, "text")) opt.format = kText;
+            else if (!strcmp(optarg, "csv")) opt.format = kCsv;
+            else if (!strcmp(optarg, "bin")) opt.format = kBin;
+            else return false;
+            break;
+        default:
+            return false;
+        }
+    }
+    if (opt.input)
+        return optind == argc;
+    if (optind != argc - 1)
+        return false;
+
+    opt.host = argv[optind];
+    size_t colon = opt.host.rfind(':');
+    if (colon != std::string::npos) {
+        opt.port = opt.host.substr(colon + 1);
+        opt.host.erase(colon);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    int fd;
+    if (opt.input)
+        fd = strcmp(opt.input, "-") ? open(opt.input, O_RDONLY) : 0;
+    else
+        fd = connectTo(opt.host, opt.port);
+    if (fd < 0) {
+        if (opt.input)
+            fprintf(stderr, "pptcat: %s: %s\n", opt.input, strerror(errno));
+        return 1;
+    }
+
+    if (opt.format == kCsv)
+        printCsvHeader();
+
+    ppt::Framer framer(opt.maxFailures);
+    ppt::DecodedFrame frame;
+    uint8_t buf[4096];
+    ppt::FrameBuffer raw;
+    unsigned long number = 0;
+
+    while (opt.count < 0 || (long)number < opt.count) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        framer.push(buf, (size_t)n);
+        while (framer.pop(raw) && (opt.count < 0 || (long)number < opt.count)) {
+            ppt::decodeFrame(raw.view(), frame);
+            printFrame(opt, number++, raw, frame);
+            if (ferror(stdout))
+                return 1;
+        }
+    }
+    if (framer.resyncs())
+        fprintf(stderr, "pptcat: %lu resyncs, %lu bytes dropped\n",
+                framer.resyncs(), framer.droppedBytes());
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,250 @@
+/*
+ * pptfleet.cpp
+ *
+ * Write the st.cmd of an IOC serving a fleet of PPT Modulators from one
+ * fleet description, one modulator per line:
+ *
+ *   # name    host[:port]            HVMAX  firmware
+ *   MOD001    192.168.197.111:2000   37     2.1
+ *   MOD002    192.168.197.112        35     2.1
+ *
+ * name is the R macro and the asyn port name (driver port name + "DRV"),
+ * HVMAX the HV limit of ppt_control.template in kV, firmware the revision
+ * of the modulator's TCP/IP interface (2.1: IF-MOD2128C Rev2-1, the only
+ * one this IOC decodes). Each modulator gets pptDriverConfigure, the lean
+ * database (ppt_lean.template, or ppt.template with -F), the control and
+ * auto sequence templates and its pptAutoSeq.
+ *
+ * pptStartupMark lines around dbLoadRecords and iocInit print the time
+ * and resident memory of each step; -n writes a synthetic fleet of N
+ * modulators on localhost for that benchmark:
+ *
+ *   pptfleet fleet.txt > st.cmd
+ *   pptfleet -n 50 > st50.cmd && ../../bin/linux-x86_64/ppt st50.cmd < /dev/null
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Modulator {
+    std::string name;
+    std::string address;
+    double hvMax;
+    std::string firmware;
+};
+
+struct Options {
+    const char *input;
+    int synthetic;
+    std::string prefix;
+    std::string top;
+    bool full;
+    bool sequencer;
+    std::string acf;
+};
+
+const char *kFirmware[] = { "2.1" };
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [options] fleet.txt\n"
+        "       %s [options] -n N\n"
+        "  -n N       synthetic fleet MOD001..MODnnn on 127.0.0.1:2000+i\n"
+        "  -P PREFIX  PV prefix, the P macro (default SPARC:MOD:PPT)\n"
+        "  -t TOP     IOC top from the boot directory (default ../..)\n"
+        "  -F         full database ppt.template instead of ppt_lean.template\n"
+        "  -S         no pptAutoSeq (IOC built without the sequencer)\n"
+        "  -a ACF     site access security file instead of TOP/db/ppt.acf; its\n"
+        "             WRITE rules need TRAPWRITE for the journal's put sources\n",
+        prog, prog);
+}
+
+bool knownFirmware(const std::string &firmware)
+{
+    for (size_t i = 0; i < sizeof(kFirmware) / sizeof(kFirmware[0]); i++)
+        if (firmware == kFirmware[i])
+            return true;
+    return false;
+}
+
+/* Read the fleet description; false after printing the first error */
+bool readFleet(const char *filename, std::vector<Modulator> &fleet)
+{
+    char line[512];
+    int lineNo = 0;
+    FILE *fp = fopen(filename, "r");
+
+    if (!fp) {
+        perror(filename);
+        return false;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char name[64], address[128], firmware[32];
+        Modulator mod;
+        int n;
+
+        lineNo++;
+        n = sscanf(line, " %63s %127s %lf %31s", name, address, &mod.hvMax, firmware);
+        if (n <= 0 || name[0] == '#')
+            continue;
+        if (n != 4 || mod.hvMax <= 0.0 || mod.hvMax > 50.0) {
+            fprintf(stderr, "%s:%d: expected \"name host[:port] HVMAX firmware\", "
+                    "HVMAX 0..50 kV\n", filename, lineNo);
+            fclose(fp);
+            return false;
+        }
+        if (!knownFirmware(firmware)) {
+            fprintf(stderr, "%s:%d: %s: firmware %s is not supported\n", filename, lineNo,
+                    name, firmware);
+            fclose(fp);
+            return false;
+        }
+        mod.name = name;
+        mod.address = address;
+        if (mod.address.find(':') == std::string::npos)
+            mod.address += ":2000";
+        mod.firmware = firmware;
+        for (size_t i = 0; i < fleet.size(); i++) {
+            if (fleet[i].name == mod.name) {
+                fprintf(stderr, "%s:%d: %s defined twice\n", filename, lineNo, name);
+                fclose(fp);
+                return false;
+            }
+        }
+        fleet.push_back(mod);
+    }
+    fclose(fp);
+    return true;
+}
+
+void syntheticFleet(int count, std::vector<Modulator> &fleet)
+{
+    for (int i = 1; i <= count; i++) {
+        char name[16], address[32];
+        Modulator mod;
+
+        sprintf(name, "MOD%03d", i);
+        sprintf(address, "127.0.0.1:%d", 2000 + i);
+        mod.name = name;
+        mod.address = address;
+        mod.hvMax = 37.0;
+        mod.firmware = kFirmware[0];
+        fleet.push_back(mod);
+    }
+}
+
+void writeStartup(const Options &opt, const std::vector<Modulator> &fleet)
+{
+    const char *P = opt.prefix.c_str();
+    const char *top = opt.top.c_str();
+
+    printf("#!%s/bin/linux-x86_64/ppt\n\n", top);
+    printf("## Generated by pptfleet from %s: %lu modulators, %s\n\n",
+           opt.input ? opt.input : "a synthetic fleet", (unsigned long)fleet.size(),
+           opt.full ? "ppt.template" : "ppt_lean.template");
+    printf("pptStartupMark start\n");
+    printf("dbLoadDatabase \"%s/dbd/ppt.dbd\"\n", top);
+    printf("ppt_registerRecordDeviceDriver pdbbase\n");
+    printf("epicsEnvSet(\"STREAM_PROTOCOL_PATH\",\"%s/db\")\n", top);
+    if (opt.full)
+        printf("pptCausalityLoad(\"%s/db/ppt_causality.txt\")\n", top);
+    /* pptCommandJournal knows the client of a put only under TRAPWRITE */
+    if (opt.acf.empty())
+        printf("asSetFilename(\"%s/db/ppt.acf\")\n", top);
+    else
+        printf("asSetFilename(\"%s\")\n", opt.acf.c_str());
+    printf("pptStartupMark registered\n");
+
+    for (size_t i = 0; i < fleet.size(); i++) {
+        const Modulator &mod = fleet[i];
+        const char *R = mod.name.c_str();
+
+        printf("\n## %s: %s, HVMAX %g kV, firmware %s\n", R, mod.address.c_str(), mod.hvMax,
+               mod.firmware.c_str());
+        printf("drvAsynIPPortConfigure(\"%s\", \"%s\", 0, 0, 0)\n", R, mod.address.c_str());
+        /* The lean database has no trend waveforms: keep the rings minimal */
+        printf("pptDriverConfigure(\"%sDRV\", \"%s\", %d)\n", R, R, opt.full ? 0 : 1);
+        printf("pptRoundTripFile(\"%sDRV\", \"roundtrip_%sDRV.txt\")\n", R, R);
+        printf("pptCommandJournal(\"%sDRV\", \"journal_%sDRV.bin\", 0)\n", R, R);
+        if (opt.full)
+            printf("dbLoadRecords(\"%s/db/ppt.template\", \"P=%s,R=%s,DRV=%sDRV\")\n",
+                   top, P, R, R);
+        else
+            printf("dbLoadRecords(\"%s/db/ppt_lean.template\", "
+                   "\"P=%s,R=%s,DRV=%sDRV,FW=%s\")\n", top, P, R, R, mod.firmware.c_str());
+        printf("dbLoadRecords(\"%s/db/ppt_control.template\", "
+               "\"P=%s,R=%s,DRV=%sDRV,HVMAX=%g\")\n", top, P, R, R, mod.hvMax);
+        printf("dbLoadRecords(\"%s/db/ppt_autoseq.template\", \"P=%s,R=%s\")\n", top, P, R);
+    }
+
+    printf("\npptStartupMark dbLoadRecords\n");
+    printf("iocInit\n");
+    printf("pptStartupMark iocInit\n");
+    if (opt.sequencer) {
+        printf("\n");
+        for (size_t i = 0; i < fleet.size(); i++)
+            printf("seq pptAutoSeq, \"P=%s,R=%s,RETRY_DELAY=5.0\"\n", P, fleet[i].name.c_str());
+    }
+}
+
+bool parseArgs(int argc, char *argv[], Options &opt)
+{
+    int c;
+
+    opt.input = NULL;
+    opt.synthetic = 0;
+    opt.prefix = "SPARC:MOD:PPT";
+    opt.top = "../..";
+    opt.full = false;
+    opt.sequencer = true;
+
+    while ((c = getopt(argc, argv, "n:P:t:a:FSh")) != -1) {
+        switch (c) {
+        case 'n': opt.synthetic = atoi(optarg); break;
+        case 'P': opt.prefix = optarg; break;
+        case 't': opt.top = optarg; break;
+        case 'F': opt.full = true; break;
+        case 'S': opt.sequencer = false; break;
+        case 'a': opt.acf = optarg; break;
+        default:
+            return false;
+        }
+    }
+    if (opt.synthetic)
+        return opt.synthetic > 0 && opt.synthetic < 1000 && optind == argc;
+    if (optind != argc - 1)
+        return false;
+    opt.input = argv[optind];
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    std::vector<Modulator> fleet;
+
+    if (!parseArgs(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (opt.synthetic)
+        syntheticFleet(opt.synthetic, fleet);
+    else if (!readFleet(opt.input, fleet))
+        return 1;
+    if (fleet.empty()) {
+        fprintf(stderr, "pptfleet: %s: no modulators\n", opt.input);
+        return 1;
+    }
+    writeStartup(opt, fleet);
+    return 0;
+}
@@ -0,0 +1,397 @@
+/*
+ * pptjournal.cpp
+ *
+ * Print, filter and replay a command journal of pptDriver (pptJournal.h,
+ * pptCommandJournal), one line per command written:
+ *
+ *   time of the put  image  CmdReg32  command  source  write  put to
+ *   written  outcome of the round trip
+ *
+ * The outcome is confirmed/timeout/superseded with the time from the
+ * write, "pending" while the round trip runs and "-" for commands without
+ * a status bit. The images ending a command pulse (Cmd:PulseHold) show as
+ * "pulse-end"; -s and -c leave them out. The journal may be read while
+ * the IOC appends to it.
+ *
+ * With -r the selected images are written again, in the writeFullCmd32
+ * format and with their original spacing (-x to speed it up), to a
+ * modulator simulator, to reproduce an incident. The pulse end following
+ * a selected image is always replayed with it, whatever -s, -c and -b
+ * select, so no ON bit is left set. Frames the simulator sends meanwhile
+ * are read and dropped. Images whose write failed are not replayed. Do
+ * not point it at a modulator in operation.
+ *
+ * Examples:
+ *   pptjournal journal_PPT1DRV.bin
+ *   pptjournal -s ramp -a "2026-10-17 14:00:00" -b "2026-10-17 14:05:00" journal.bin
+ *   pptjournal -c HVPS:OnCmd -n 20 journal.bin
+ *   pptjournal -a 1792245600 -r localhost:2000 -x 10 journal.bin
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pptProto.h"
+#include "pptCommand.h"
+#include "pptJournal.h"
+
+namespace {
+
+struct Options {
+    const char *journal;
+    const char *source;
+    int command;            /* -1: all */
+    uint64_t after;         /* ns since the Epoch, 0: no bound */
+    uint64_t before;
+    long last;              /* 0: all */
+    std::string host;       /* replay target, empty: print only */
+    std::string port;
+    double speed;
+};
+
+typedef std::map<std::pair<uint32_t, int>, ppt::JournalEntry> ResultMap;
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [options] journal\n"
+        "  -s SOURCE   commands of sources containing SOURCE (local, ramp, ioc, user@host)\n"
+        "  -c COMMAND  commands named COMMAND, e.g. HVPS:OnCmd, HVPS:VoltageSet\n"
+        "  -a TIME     put at or after TIME (\"YYYY-MM-DD HH:MM:SS\" or POSIX seconds)\n"
+        "  -b TIME     put before TIME\n"
+        "  -n N        the last N selected commands\n"
+        "  -r HOST[:PORT]  replay the selected images to a simulator (default port 2000)\n"
+        "  -x FACTOR   replay FACTOR times faster (default 1, 0: no waits)\n"
+        "  -h          show this help\n",
+        prog);
+}
+
+/* "YYYY-MM-DD HH:MM:SS" local time or POSIX seconds, in ns; false if neither */
+bool parseTime(const char *text, uint64_t &ns)
+{
+    struct tm tm;
+    const char *end;
+    char *stop;
+    double seconds = strtod(text, &stop);
+
+    if (stop != text && *stop == '\0' && seconds >= 0.0) {
+        ns = (uint64_t)(seconds * 1e9);
+        return true;
+    }
+    memset(&tm, 0, sizeof(tm));
+    if (!(end = strptime(text, "%Y-%m-%d %H:%M:%S", &tm)) &&
+        !(end = strptime(text, "%Y-%m-%dT%H:%M:%S", &tm)))
+        return false;
+    if (*end != '\0')
+        return false;
+    tm.tm_isdst = -1;
+    ns = (uint64_t)mktime(&tm) * 1000000000ull;
+    return true;
+}
+
+int findCommand(const char *name)
+{
+    for (int k = 0; k < ppt::kNumCommandKinds; k++)
+        if (strcmp(ppt::commandKindName(k), name) == 0)
+            return k;
+    return -1;
+}
+
+bool parseArgs(int argc, char *argv[], Options &opt)
+{
+    int c;
+
+    opt.journal = NULL;
+    opt.source = NULL;
+    opt.command = -1;
+    opt.after = 0;
+    opt.before = 0;
+    opt.last = 0;
+    opt.port = "2000";
+    opt.speed = 1.0;
+
+    while ((c = getopt(argc, argv, "s:c:a:b:n:r:x:h")) != -1) {
+        switch (c) {
+        case 's': opt.source = optarg; break;
+        case 'c':
+            if ((opt.command = findCommand(optarg)) < 0) {
+                fprintf(stderr, "pptjournal: unknown command %s\n", optarg);
+                return false;
+            }
+            break;
+        case 'a':
+        case 'b':
+            if (!parseTime(optarg, c == 'a' ? opt.after : opt.before)) {
+                fprintf(stderr, "pptjournal: bad time %s\n", optarg);
+                return false;
+            }
+            break;
+        case 'n': opt.last = atol(optarg); break;
+        case 'r': {
+            size_t colon;
+
+            opt.host = optarg;
+            colon = opt.host.rfind(':');
+            if (colon != std::string::npos) {
+                opt.port = opt.host.substr(colon + 1);
+                opt.host.erase(colon);
+            }
+            break;
+        }
+        case 'x': opt.speed = atof(optarg); break;
+        default:
+            return false;
+        }
+    }
+    if (opt.last < 0 || !(opt.speed >= 0.0) || optind != argc - 1)
+        return false;
+    opt.journal = argv[optind];
+    return true;
+}
+
+bool selected(const Options &opt, const ppt::CommandJournal &journal,
+              const ppt::JournalEntry &entry)
+{
+    if (opt.after && entry.time < opt.after)
+        return false;
+    if (opt.before && entry.time >= opt.before)
+        return false;
+    if (entry.kind == ppt::kJournalClear)
+        return opt.command < 0 && !opt.source;
+    if (entry.kind != ppt::kJournalWrite)
+        return false;
+    if (opt.command >= 0 && entry.command != opt.command)
+        return false;
+    if (opt.source && !strstr(journal.sourceName(entry.source), opt.source))
+        return false;
+    return true;
+}
+
+void formatTime(uint64_t ns, char *buf, size_t len)
+{
+    time_t seconds = (time_t)(ns / 1000000000ull);
+    struct tm tm;
+    size_t n;
+
+    localtime_r(&seconds, &tm);
+    n = strftime(buf, len, "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(buf + n, len - n, ".%06lu", (unsigned long)(ns % 1000000000ull / 1000));
+}
+
+void printEntry(const ppt::CommandJournal &journal, const ppt::JournalEntry &entry,
+                const ResultMap &results)
+{
+    ResultMap::const_iterator result = results.find(std::make_pair(entry.image,
+                                                                   (int)entry.command));
+    ppt::CommandEffect effect;
+    char stamp[40], outcome[40];
+
+    formatTime(entry.time, stamp, sizeof(stamp));
+    if (entry.kind == ppt::kJournalClear) {
+        printf("%s #%-7u 0x%08X %-16s %-24s %s\n", stamp, entry.image, entry.value, "pulse-end",
+               "-", ppt::journalOutcomeName(entry.outcome));
+        return;
+    }
+    if (result != results.end())
+        snprintf(outcome, sizeof(outcome), "%s %.1f ms",
+                 ppt::journalOutcomeName(result->second.outcome),
+                 result->second.latency / 1e3);
+    else if (entry.outcome == ppt::kOutcomeWritten && ppt::commandEffect(entry.command, effect))
+        strcpy(outcome, "pending");
+    else
+        strcpy(outcome, "-");
+    printf("%s #%-7u 0x%08X %-16s %-24s %-11s %8.1f ms  %s\n", stamp, entry.image, entry.value,
+           ppt::commandKindName(entry.command), journal.sourceName(entry.source),
+           ppt::journalOutcomeName(entry.outcome), entry.latency / 1e3, outcome);
+}
+
+int connectTo(const std::string &host, const std::string &port)
+{
+    struct addrinfo hints, *res, *ai;
+    int status, fd = -1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    status = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+    if (status != 0) {
+        fprintf(stderr, "pptjournal: %s: %s\n", host.c_str(), gai_strerror(status));
+        return -1;
+    }
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0)
+        fprintf(stderr, "pptjournal: cannot connect to %s:%s: %s\n", host.c_str(),
+                port.c_str(), strerror(errno));
+    return fd;
+}
+
+double monotonicSeconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Read and drop what the simulator sends until the monotonic time due */
+bool drainUntil(int fd, double due)
+{
+    char buf[1024];
+
+    for (;;) {
+        double left = due - monotonicSeconds();
+        struct pollfd pfd;
+        ssize_t n;
+
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, left > 0.0 ? (int)(left * 1e3) + 1 : 0) <= 0) {
+            if (left <= 0.0)
+                return true;
+            continue;
+        }
+        n = read(fd, buf, sizeof(buf));
+        if (n == 0 || (n < 0 && errno != EINTR)) {
+            fprintf(stderr, "pptjournal: connection closed by the simulator\n");
+            return false;
+        }
+    }
+}
+
+bool imageBefore(const ppt::JournalEntry &a, const ppt::JournalEntry &b)
+{
+    return a.image < b.image;
+}
+
+/*
+ * Add the pulse ends of the images in writes that are not in it yet, in the
+ * order written. The pulse end of image N is the Clear entry N + 1: the
+ * driver numbers it right after the image, or writes none when another
+ * image comes first.
+ */
+void addPulseEnds(const ppt::CommandJournal &journal, std::vector<ppt::JournalEntry> &writes)
+{
+    std::set<uint32_t> images;
+    uint64_t count = journal.count();
+
+    for (size_t i = 0; i < writes.size(); i++)
+        images.insert(writes[i].image);
+    for (uint64_t i = journal.first(); i < count; i++) {
+        const ppt::JournalEntry &entry = journal.entry(i);
+
+        if (entry.kind == ppt::kJournalClear && !images.count(entry.image) &&
+            images.count(entry.image - 1))
+            writes.push_back(entry);
+    }
+    std::stable_sort(writes.begin(), writes.end(), imageBefore);
+}
+
+/* Write the images of the selected entries with their original spacing */
+int replay(const Options &opt, const ppt::CommandJournal &journal,
+           const std::vector<ppt::JournalEntry> &writes)
+{
+    uint8_t out[ppt::kCmd32Bytes];
+    uint64_t first = 0;
+    double start;
+    int fd, images = 0;
+
+    if ((fd = connectTo(opt.host, opt.port)) < 0)
+        return 1;
+    signal(SIGPIPE, SIG_IGN);
+    start = monotonicSeconds();
+    for (size_t i = 0; i < writes.size(); i++) {
+        const ppt::JournalEntry &entry = writes[i];
+        uint64_t written = entry.time + entry.latency * 1000ull;
+
+        /* A coalesced image once, for its first selected command */
+        if (entry.outcome != ppt::kOutcomeWritten ||
+            (i > 0 && writes[i - 1].image == entry.image))
+            continue;
+        if (!images)
+            first = written;
+        if (opt.speed > 0.0 && !drainUntil(fd, start + (written - first) * 1e-9 / opt.speed))
+            break;
+        ppt::encodeCommand32(entry.value, out);
+        if (write(fd, out, sizeof(out)) != (ssize_t)sizeof(out)) {
+            fprintf(stderr, "pptjournal: write: %s\n", strerror(errno));
+            break;
+        }
+        images++;
+        if (entry.kind == ppt::kJournalClear)
+            printf("replayed #%u 0x%08X pulse-end\n", entry.image, entry.value);
+        else
+            printf("replayed #%u 0x%08X %s %s\n", entry.image, entry.value,
+                   ppt::commandKindName(entry.command), journal.sourceName(entry.source));
+        fflush(stdout);
+    }
+    close(fd);
+    fprintf(stderr, "pptjournal: %d images replayed to %s:%s\n", images, opt.host.c_str(),
+            opt.port.c_str());
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    ppt::CommandJournal journal;
+    std::vector<ppt::JournalEntry> writes;
+    ResultMap results;
+    std::string error;
+    uint64_t count;
+
+    if (!parseArgs(argc, argv, opt)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!journal.open(opt.journal, 0, false, error)) {
+        fprintf(stderr, "pptjournal: %s: %s\n", opt.journal, error.c_str());
+        return 1;
+    }
+
+    count = journal.count();
+    for (uint64_t i = journal.first(); i < count; i++) {
+        const ppt::JournalEntry &entry = journal.entry(i);
+
+        if (entry.kind == ppt::kJournalResult)
+            results[std::make_pair(entry.image, (int)entry.command)] = entry;
+        else if (selected(opt, journal, entry))
+            writes.push_back(entry);
+    }
+    if (opt.last && writes.size() > (size_t)opt.last)
+        writes.erase(writes.begin(), writes.end() - opt.last);
+
+    if (!opt.host.empty()) {
+        addPulseEnds(journal, writes);
+        return replay(opt, journal, writes);
+    }
+    for (size_t i = 0; i < writes.size(); i++)
+        printEntry(journal, writes[i], results);
+    return 0;
+}